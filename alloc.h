@@ -3,6 +3,10 @@
 namespace pbbs {
   void* my_alloc(size_t);
   void my_free(void*);
+  // for memory an allocator keeps for itself (e.g. the blocks of a
+  // block_allocator), which is not counted as in use
+  void* my_alloc_held(size_t);
+  void my_free_held(void*);
 }
 
 #include <atomic>
@@ -33,6 +37,9 @@ namespace pbbs {
   //   thread local list of elements from each pool using the
   //   block_allocator.
   // For pools of large blocks there is only one shared pool for each.
+  // Keeps count of the bytes held from the system (including free blocks
+  // in the pools) and of the bytes in use, i.e. allocated and not yet
+  // deallocated.
   struct pool_allocator {
 
   private:
@@ -43,6 +50,8 @@ namespace pbbs {
     size_t max_small;
     size_t max_size;
     std::atomic<long> large_allocated{0};
+    std::atomic<long> in_use{0};
+    std::atomic<long> peak_in_use{0};
   
     concurrent_stack<void*>* large_buckets;
     struct block_allocator *small_allocators;
@@ -63,7 +72,7 @@ namespace pbbs {
       void* a = (void*) aligned_alloc(large_align, alloc_size);
       if (a == NULL) throw std::bad_alloc();
       
-      large_allocated += n;
+      large_allocated += alloc_size;
       return a;
     }
 
@@ -118,14 +127,25 @@ namespace pbbs {
       }
     }
 
-    void* allocate(size_t n) {
-      if (n > max_small) return allocate_large(n);
-      size_t bucket = 0;
-      while (n > sizes[bucket]) bucket++;
-      return small_allocators[bucket].alloc();
+    // counted is false for memory that another allocator holds for
+    // itself, and must match between allocate and deallocate
+    void* allocate(size_t n, bool counted = true) {
+      void* r;
+      if (n > max_small) r = allocate_large(n);
+      else {
+	size_t bucket = 0;
+	while (n > sizes[bucket]) bucket++;
+	r = small_allocators[bucket].alloc();
+      }
+      if (counted) {
+	long u = (in_use += n);
+	write_max(&peak_in_use, u, std::less<long>());
+      }
+      return r;
     }
 
-    void deallocate(void* ptr, size_t n) {
+    void deallocate(void* ptr, size_t n, bool counted = true) {
+      if (counted) in_use -= n;
       if (n > max_small) deallocate_large(ptr, n);
       else {
 	size_t bucket = 0;
@@ -149,6 +169,21 @@ namespace pbbs {
       	deallocate(h[i], small_alloc_block_size);
     }
 
+    // All memory, including the blocks for small allocations, is
+    // obtained through allocate_large, so this is the total held from
+    // the system, whether in use or in the pools.
+    size_t bytes_allocated() {return large_allocated;}
+
+    // bytes allocated and not yet deallocated (not counting the blocks
+    // held by block allocators, but counting the elements given out of
+    // the pool's own)
+    size_t bytes_in_use() {return in_use;}
+
+    // peak of bytes_in_use() since start or last reset_peak()
+    size_t peak_bytes_in_use() {return peak_in_use;}
+
+    void reset_peak() {peak_in_use = in_use.load();}
+
     void print_stats() {
       size_t total_a = 0;
       size_t total_u = 0;
@@ -195,6 +230,16 @@ namespace pbbs {
 
   pool_allocator default_allocator(default_sizes());
 
+  // lets the phase profiler (get_time.h) record the change in bytes in
+  // use per phase
+  struct __profile_memory {
+    __profile_memory() {
+      phase_profiler::get().memory = [] () -> long {
+	return default_allocator.bytes_in_use();};
+    }
+  };
+  static __profile_memory __profile_memory_var;
+
   // ****************************************
   // Following Matches the c++ Allocator specification (minimally)
   // https://en.cppreference.com/w/cpp/named_req/Allocator
@@ -279,6 +324,8 @@ namespace pbbs {
   
   inline void* my_alloc(size_t i) {return malloc(i);}
   inline void my_free(void* p) {free(p);}
+  inline void* my_alloc_held(size_t i) {return malloc(i);}
+  inline void my_free_held(void* p) {free(p);}
   void allocator_clear() {}
   void allocator_reserve(size_t bytes) {}
 
@@ -292,26 +339,32 @@ namespace pbbs {
   }
 
   // allocates and tags with a header (8, 16 or 64 bytes) that contains the size
-  void* my_alloc(size_t n) {
+  void* my_alloc_(size_t n, bool counted) {
     size_t hsize = header_size(n);
     void* ptr;
-    ptr = default_allocator.allocate(n + hsize);
+    ptr = default_allocator.allocate(n + hsize, counted);
     void* r = (void*) (((char*) ptr) + hsize);
     *(((size_t*) r)-size_offset) = n; // puts size in header
     return r;
   }
 
   // reads the size, offsets the header and frees
-  void my_free(void *ptr) {
+  void my_free_(void *ptr, bool counted) {
     size_t n = *(((size_t*) ptr)-size_offset);
     size_t hsize = header_size(n);
     if (hsize > (1ul << 48)) {
       cout << "corrupted header in my_free" << endl;
       throw std::bad_alloc(); 
     }
-    default_allocator.deallocate((void*) (((char*) ptr) - hsize), n + hsize);
+    default_allocator.deallocate((void*) (((char*) ptr) - hsize), n + hsize,
+				 counted);
   }
 
+  void* my_alloc(size_t n) {return my_alloc_(n, true);}
+  void my_free(void *ptr) {my_free_(ptr, true);}
+  void* my_alloc_held(size_t n) {return my_alloc_(n, false);}
+  void my_free_held(void *ptr) {my_free_(ptr, false);}
+
   void allocator_clear() {
     default_allocator.clear();
   }
@@ -114,7 +114,7 @@ size_t block_allocator::num_used_blocks() {
 auto block_allocator::allocate_blocks(size_t num_blocks) -> char* {
   //char* start = (char*) aligned_alloc(pad_size,
   //num_blocks * block_size_+ pad_size);
-  char* start = (char*) pbbs::my_alloc(num_blocks * block_size_);
+  char* start = (char*) pbbs::my_alloc_held(num_blocks * block_size_);
   if (start == NULL) {
     fprintf(stderr, "Cannot allocate space in block_allocator");
     exit(1); }
@@ -188,7 +188,7 @@ void block_allocator::clear() {
   
     // throw away all allocated memory
     maybe<char*> x;
-    while ((x = pool_roots.pop())) pbbs::my_free(*x); //std::free(*x);
+    while ((x = pool_roots.pop())) pbbs::my_free_held(*x); //std::free(*x);
     pool_roots.clear();
     global_stack.clear();
     blocks_allocated = 0;
@@ -60,7 +60,8 @@ namespace pbbs {
 			      M const &monoid,
 			      size_t num_buckets) {
     size_t n = A.size();
-    for (size_t i = 0; i < num_buckets; i++) Out[i] = monoid.identity;
+    for (size_t i = 0; i < num_buckets; i++)
+      assign_uninitialized(Out[i], monoid.identity);
     for (size_t j = 0; j < n; j++) {
       size_t k = get_key(A[j]);
       Out[k] = monoid.f(Out[k], get_value(A[j]));
@@ -75,7 +76,7 @@ namespace pbbs {
 			      size_t num_buckets) ->
     sequence<decltype(get_value(A[0]))> {
     using val_type = decltype(get_value(A[0]));
-    sequence<val_type> Out(num_buckets);
+    sequence<val_type> Out(num_buckets, uninitialized);
     seq_collect_reduce_few(A, Out, get_key, get_value, monoid, num_buckets);
     return Out;
   }
@@ -104,16 +105,42 @@ namespace pbbs {
 
     num_blocks = 1 << log2_up(num_blocks);
 
-    sequence<val_type> Out(num_buckets);
-
     // if insufficient parallelism, do sequentially
     if (n < CR_SEQ_THRESHOLD || num_blocks == 1 || num_threads == 1)
       return seq_collect_reduce_few(A, get_key, get_value, monoid, num_buckets);
 
+    // With a commutative monoid each worker accumulates into its own
+    // row, in whatever order it gets the blocks, so the number of rows
+    // to initialize and sum across is the number of workers, and the
+    // blocks can be small for load balance.  Floating point sums would
+    // then depend on the schedule, so they use fixed blocks below.
+    if constexpr (is_reorderable<M, val_type>) {
+      size_t m = num_threads * num_buckets;
+      sequence<val_type> OutM(m, [&] (size_t) {return monoid.identity;});
+      sliced_for(n, 4 * CR_SEQ_THRESHOLD, [&] (size_t, size_t start, size_t end) {
+	  auto O = OutM.slice(worker_id() * num_buckets,
+			      (worker_id() + 1) * num_buckets);
+	  for (size_t j = start; j < end; j++) {
+	    size_t k = get_key(A[j]);
+	    O[k] = monoid.f(O[k], get_value(A[j]));
+	  }});
+      t.next("worker reduces");
+
+      sequence<val_type> Out(num_buckets, uninitialized);
+      parallel_for (0, num_buckets, [&] (size_t i) {
+	  val_type o_val = OutM[i];
+	  for (size_t j = 1; j < num_threads; j++)
+	    o_val = monoid.f(o_val, OutM[i + j*num_buckets]);
+	  assign_uninitialized(Out[i], o_val);
+	}, 1);
+      t.next("cross sums");
+      return Out;
+    }
+
     size_t block_size = ((n-1)/num_blocks) + 1;
     size_t m = num_blocks * num_buckets;
 
-    sequence<val_type> OutM(m);
+    sequence<val_type> OutM(m, uninitialized);
 
     sliced_for(n, block_size, [&] (size_t i, size_t start, size_t end) {
 	seq_collect_reduce_few(A.slice(start,end),
@@ -123,11 +150,12 @@ namespace pbbs {
       });
     t.next("sequential reduces");
 
+    sequence<val_type> Out(num_buckets, uninitialized);
     parallel_for (0, num_buckets, [&] (size_t i) {
 	val_type o_val = monoid.identity;
 	for (size_t j = 0; j < num_blocks; j++)
 	  o_val = monoid.f(o_val, OutM[i + j*num_buckets]);
-	Out[i] = o_val;
+	assign_uninitialized(Out[i], o_val);
       }, 1);
     t.next("cross sums");
 
@@ -361,7 +389,7 @@ namespace pbbs {
     parallel_for(0, num_tables, [&] (size_t i) {
       T* my_table = table.begin() + i * table_size;
 
-      sequence<bool> flags(table_size, false);
+      sequence<bool> flags(table_size, zeroed);
       // clear tables
       //for (size_t i = 0; i < table_size; i++)
       // assign_uninitialized(my_table[i], T(empty, identity));
@@ -0,0 +1,489 @@
+// This code is part of the Problem Based Benchmark Suite (PBBS)
+// Copyright (c) 2011-2019 Guy Blelloch and the PBBS team
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights (to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+// LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// Compressed sequences of unsigned integers.
+//
+// A compressed_sequence<T, Codec> cuts its input into blocks of
+// block_size elements, and encodes each block on its own with the
+// codec.  Blocks are encoded and decoded in parallel, and an index of
+// the byte offset of each block gives random access.  The codecs are:
+//
+//   bitpack_codec : each element in the number of bits of the largest
+//                   in the block
+//   for_codec     : frame of reference, i.e. the block minimum, then
+//                   each element minus the minimum, bitpacked
+//   delta_codec   : the first element, then the differences between
+//                   consecutive elements, frame of reference coded.
+//                   Good for sorted (or nearly sorted) sequences, such
+//                   as offsets.
+//   group_varint_codec : groups of four elements preceded by a byte
+//                   giving the length of each (1, 2, 3, 4 bytes for
+//                   32 bit and 1, 2, 4, 8 bytes for 64 bit types)
+//
+// bitpack_codec and for_codec support O(1) access to an element, the
+// others decode a prefix of its block.
+//
+// A codec is a struct with the static members
+//   id : a character identifying the codec in saved files
+//   size(A, n) : bytes to encode A[0..n)
+//   encode(A, n, out) : writes size(A, n) bytes to out
+//   decode(in, n, out) : decodes n elements to out
+//   get(in, n, j) : element j of the n encoded at in
+// Decoders can read up to 8 bytes past the end of the encoding.
+
+#pragma once
+
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+#include "sequence.h"
+#include "monoid.h"
+#include "strings/string_basics.h"
+
+namespace pbbs {
+
+  // writes v as a varint (7 bits per byte, high bit set if more follow)
+  inline uint8_t* encode_varint(uint64_t v, uint8_t* p) {
+    while (v >= 128) {*p++ = (v & 127) | 128; v >>= 7;}
+    *p++ = v;
+    return p;
+  }
+
+  inline uint64_t decode_varint(const uint8_t* &p) {
+    uint64_t v = 0;
+    for (int shift = 0; ; shift += 7) {
+      uint8_t b = *p++;
+      v |= ((uint64_t) (b & 127)) << shift;
+      if (b < 128) return v;
+    }
+  }
+
+  inline size_t varint_size(uint64_t v) {
+    size_t s = 1;
+    while (v >= 128) {v >>= 7; s++;}
+    return s;
+  }
+
+  // number of bits needed to represent x
+  inline int bit_width(uint64_t x) {
+    return (x == 0) ? 0 : 64 - __builtin_clzll(x);
+  }
+
+  inline uint64_t load_word(const uint8_t* p) {
+    uint64_t w; memcpy(&w, p, 8); return w;
+  }
+
+  inline uint64_t low_bits(uint64_t x, int b) {
+    return (b == 64) ? x : x & ((((uint64_t) 1) << b) - 1);
+  }
+
+  // The b bit value starting at bit i of p
+  inline uint64_t read_bits(const uint8_t* p, size_t i, int b) {
+    const uint8_t* q = p + i / 8;
+    int o = i % 8;
+    uint64_t w = load_word(q) >> o;
+    if (o + b > 64) w |= ((uint64_t) q[8]) << (64 - o);
+    return low_bits(w, b);
+  }
+
+  // Calls f(i, v) for each of the n values v of b bits starting at p.
+  // Values of up to 56 bits are read with a single unaligned load.
+  template <class F>
+  void unpack_bits(const uint8_t* p, size_t n, int b, F f) {
+    if (b == 0) for (size_t i = 0; i < n; i++) f(i, 0);
+    else if (b <= 56) {
+      uint64_t mask = low_bits(~((uint64_t) 0), b);
+      for (size_t i = 0; i < n; i++) {
+	size_t j = i * b;
+	f(i, (load_word(p + j / 8) >> (j % 8)) & mask);
+      }
+    } else for (size_t i = 0; i < n; i++) f(i, read_bits(p, i * b, b));
+  }
+
+  // Writes n values of b bits each, returning the end of the output.
+  // F(i) gives the ith value, which must fit in b bits.
+  template <class F>
+  uint8_t* write_bits(uint8_t* p, size_t n, int b, F f) {
+    uint64_t buf = 0;
+    int used = 0;
+    if (b == 0) return p;
+    for (size_t i = 0; i < n; i++) {
+      uint64_t v = f(i);
+      buf |= v << used;
+      if (used + b >= 64) {
+	memcpy(p, &buf, 8); p += 8;
+	buf = (used == 0) ? 0 : v >> (64 - used);
+	used = used + b - 64;
+      } else used += b;
+    }
+    int bytes = (used + 7) / 8;
+    memcpy(p, &buf, bytes);
+    return p + bytes;
+  }
+
+  inline size_t bitpacked_size(size_t n, int b) {return (n * b + 7) / 8;}
+
+  struct bitpack_codec {
+    static constexpr char id = 'b';
+
+    template <class T>
+    static int width(const T* A, size_t n) {
+      T m = 0;
+      for (size_t i = 0; i < n; i++) m |= A[i];
+      return bit_width(m);
+    }
+
+    template <class T>
+    static size_t size(const T* A, size_t n) {
+      return 1 + bitpacked_size(n, width(A, n));
+    }
+
+    template <class T>
+    static void encode(const T* A, size_t n, uint8_t* out) {
+      int b = width(A, n);
+      *out = b;
+      write_bits(out + 1, n, b, [&] (size_t i) {return (uint64_t) A[i];});
+    }
+
+    template <class T>
+    static void decode(const uint8_t* in, size_t n, T* out) {
+      int b = *in;
+      unpack_bits(in + 1, n, b, [&] (size_t i, uint64_t v) {out[i] = v;});
+    }
+
+    template <class T>
+    static T get(const uint8_t* in, size_t, size_t j) {
+      int b = *in;
+      return read_bits(in + 1, j * b, b);
+    }
+  };
+
+  struct for_codec {
+    static constexpr char id = 'f';
+
+    template <class T>
+    static std::pair<T,int> frame(const T* A, size_t n) {
+      T mn = A[0], mx = A[0];
+      for (size_t i = 1; i < n; i++) {
+	mn = std::min(mn, A[i]);
+	mx = std::max(mx, A[i]);
+      }
+      return std::make_pair(mn, bit_width(mx - mn));
+    }
+
+    template <class T>
+    static size_t size(const T* A, size_t n) {
+      return sizeof(T) + 1 + bitpacked_size(n, frame(A, n).second);
+    }
+
+    template <class T>
+    static void encode(const T* A, size_t n, uint8_t* out) {
+      auto [mn, b] = frame(A, n);
+      memcpy(out, &mn, sizeof(T));
+      out[sizeof(T)] = b;
+      write_bits(out + sizeof(T) + 1, n, b, [&] (size_t i) {
+	  return (uint64_t) (T) (A[i] - mn);});
+    }
+
+    template <class T>
+    static void decode(const uint8_t* in, size_t n, T* out) {
+      T mn; memcpy(&mn, in, sizeof(T));
+      int b = in[sizeof(T)];
+      in += sizeof(T) + 1;
+      unpack_bits(in, n, b, [&] (size_t i, uint64_t v) {out[i] = mn + v;});
+    }
+
+    template <class T>
+    static T get(const uint8_t* in, size_t, size_t j) {
+      T mn; memcpy(&mn, in, sizeof(T));
+      int b = in[sizeof(T)];
+      return mn + read_bits(in + sizeof(T) + 1, j * b, b);
+    }
+  };
+
+  // The differences are taken modulo 2^bits(T) and framed as signed
+  // values, so decreasing runs are fine too.
+  struct delta_codec {
+    static constexpr char id = 'd';
+
+    template <class T>
+    static std::pair<T,int> frame(const T* A, size_t n) {
+      using S = std::make_signed_t<T>;
+      if (n < 2) return std::make_pair((T) 0, 0);
+      S mn = A[1] - A[0], mx = mn;
+      for (size_t i = 2; i < n; i++) {
+	S d = A[i] - A[i-1];
+	mn = std::min(mn, d);
+	mx = std::max(mx, d);
+      }
+      return std::make_pair((T) mn, bit_width((T) ((T) mx - (T) mn)));
+    }
+
+    template <class T>
+    static size_t size(const T* A, size_t n) {
+      return 2 * sizeof(T) + 1 + bitpacked_size(n - 1, frame(A, n).second);
+    }
+
+    template <class T>
+    static void encode(const T* A, size_t n, uint8_t* out) {
+      auto [mn, b] = frame(A, n);
+      memcpy(out, A, sizeof(T));
+      memcpy(out + sizeof(T), &mn, sizeof(T));
+      out[2 * sizeof(T)] = b;
+      write_bits(out + 2 * sizeof(T) + 1, n - 1, b, [&] (size_t i) {
+	  return (uint64_t) (T) (A[i+1] - A[i] - mn);});
+    }
+
+    template <class T>
+    static void decode(const uint8_t* in, size_t n, T* out) {
+      T v, mn;
+      memcpy(&v, in, sizeof(T));
+      memcpy(&mn, in + sizeof(T), sizeof(T));
+      int b = in[2 * sizeof(T)];
+      in += 2 * sizeof(T) + 1;
+      out[0] = v;
+      unpack_bits(in, n - 1, b, [&] (size_t i, uint64_t d) {
+	  out[i+1] = (v += mn + (T) d);});
+    }
+
+    template <class T>
+    static T get(const uint8_t* in, size_t, size_t j) {
+      T v, mn;
+      memcpy(&v, in, sizeof(T));
+      memcpy(&mn, in + sizeof(T), sizeof(T));
+      int b = in[2 * sizeof(T)];
+      in += 2 * sizeof(T) + 1;
+      v += j * mn;
+      for (size_t i = 0; i < j; i++) v += (T) read_bits(in, i * b, b);
+      return v;
+    }
+  };
+
+  struct group_varint_codec {
+    static constexpr char id = 'g';
+
+    // code (0..3) for the number of bytes of x
+    template <class T>
+    static int code(T x) {
+      if (sizeof(T) <= 4) {
+	int b = (bit_width(x) + 7) / 8;
+	return (b == 0) ? 0 : b - 1;
+      }
+      return (x < (1ul << 8)) ? 0 : (x < (1ul << 16)) ? 1
+	: (x < (1ul << 32)) ? 2 : 3;
+    }
+
+    template <class T>
+    static int bytes(int c) {return (sizeof(T) <= 4) ? c + 1 : 1 << c;}
+
+    template <class T>
+    static size_t size(const T* A, size_t n) {
+      size_t s = (n + 3) / 4;
+      for (size_t i = 0; i < n; i++) s += bytes<T>(code(A[i]));
+      return s;
+    }
+
+    template <class T>
+    static void encode(const T* A, size_t n, uint8_t* out) {
+      for (size_t i = 0; i < n; i += 4) {
+	uint8_t* tag = out++;
+	*tag = 0;
+	for (size_t k = 0; k < 4 && i + k < n; k++) {
+	  int c = code(A[i+k]);
+	  *tag |= c << (2 * k);
+	  uint64_t v = A[i+k];
+	  memcpy(out, &v, bytes<T>(c));
+	  out += bytes<T>(c);
+	}
+      }
+    }
+
+    template <class T>
+    static void decode(const uint8_t* in, size_t n, T* out) {
+      for (size_t i = 0; i < n; i += 4) {
+	uint8_t tag = *in++;
+	for (size_t k = 0; k < 4 && i + k < n; k++) {
+	  int b = bytes<T>((tag >> (2 * k)) & 3);
+	  out[i+k] = low_bits(load_word(in), 8 * b);
+	  in += b;
+	}
+      }
+    }
+
+    template <class T>
+    static T get(const uint8_t* in, size_t, size_t j) {
+      // skip whole groups using their tags
+      for (size_t i = 0; i < j / 4; i++) {
+	uint8_t tag = *in++;
+	for (int k = 0; k < 4; k++) in += bytes<T>((tag >> (2 * k)) & 3);
+      }
+      uint8_t tag = *in++;
+      for (size_t k = 0; k < j % 4; k++) in += bytes<T>((tag >> (2 * k)) & 3);
+      int b = bytes<T>((tag >> (2 * (j % 4))) & 3);
+      return low_bits(load_word(in), 8 * b);
+    }
+  };
+
+  template <class T, class Codec>
+  struct compressed_sequence {
+    static_assert(std::is_integral<T>::value && std::is_unsigned<T>::value,
+		  "compressed_sequence requires an unsigned integer type");
+    static constexpr size_t block_size = 256;
+    // decoders can read this far past the encoding
+    static constexpr size_t padding = 16;
+    using value_type = T;
+
+    compressed_sequence() : n(0) {}
+
+    // Encodes any sequence of T (e.g. a sequence or a delayed_seq)
+    template <class Seq>
+    compressed_sequence(Seq const &A) : n(A.size()) {
+      size_t nb = num_blocks();
+      offsets = sequence<size_t>(nb + 1);
+      auto get_block = [&] (size_t b, T* buf) {
+	size_t s = b * block_size, len = block_len(b);
+	for (size_t j = 0; j < len; j++) buf[j] = A[s + j];
+	return len;
+      };
+      parallel_for(0, nb, [&] (size_t b) {
+	  T buf[block_size];
+	  size_t len = get_block(b, buf);
+	  offsets[b] = Codec::size(buf, len);});
+      size_t total = scan_inplace(offsets.slice(0, nb), addm<size_t>());
+      offsets[nb] = total;
+      bytes = sequence<uint8_t>(total + padding, (uint8_t) 0);
+      parallel_for(0, nb, [&] (size_t b) {
+	  T buf[block_size];
+	  size_t len = get_block(b, buf);
+	  Codec::encode(buf, len, bytes.begin() + offsets[b]);});
+    }
+
+    size_t size() const {return n;}
+
+    // bytes used, not counting the object itself
+    size_t size_in_bytes() const {
+      return bytes.size() + offsets.size() * sizeof(size_t);}
+
+    size_t num_blocks() const {return (n + block_size - 1) / block_size;}
+
+    T operator[] (size_t i) const {
+      size_t b = i / block_size;
+      return Codec::template get<T>(bytes.begin() + offsets[b],
+				    block_len(b), i % block_size);
+    }
+
+    // decodes block b (of block_len(b) elements) into out
+    void decode_block(size_t b, T* out) const {
+      Codec::decode(bytes.begin() + offsets[b], block_len(b), out);
+    }
+
+    size_t block_len(size_t b) const {
+      return std::min(block_size, n - b * block_size);}
+
+    // decodes elements [s, e) in parallel
+    sequence<T> decode(size_t s, size_t e) const {
+      sequence<T> r = sequence<T>::no_init(e - s);
+      if (s == e) return r;
+      size_t first = s / block_size, last = (e - 1) / block_size;
+      parallel_for(first, last + 1, [&] (size_t b) {
+	  size_t bs = b * block_size, be = bs + block_len(b);
+	  if (bs >= s && be <= e) decode_block(b, r.begin() + (bs - s));
+	  else {
+	    T buf[block_size];
+	    decode_block(b, buf);
+	    for (size_t j = std::max(bs, s); j < std::min(be, e); j++)
+	      r[j - s] = buf[j - bs];
+	  }}, 1);
+      return r;
+    }
+
+    sequence<T> decode() const {return decode(0, n);}
+
+    // The file has a header (an 8 character magic string ending in the
+    // codec id, the element size, the length and the number of encoded
+    // bytes), then the block offsets, then the encoded blocks.
+    void save(std::string filename) const {
+      header h = file_header();
+      h.n = n;
+      h.num_bytes = offsets[num_blocks()];
+      size_t ho = sizeof(header);
+      size_t oo = ho + offsets.size() * sizeof(size_t);
+      sequence<char> out = sequence<char>::no_init(oo + h.num_bytes);
+      memcpy(out.begin(), &h, ho);
+      memcpy(out.begin() + ho, offsets.begin(), oo - ho);
+      parallel_for(0, h.num_bytes, [&] (size_t i) {
+	  out[oo + i] = bytes[i];});
+      if (char_seq_to_file(out, filename) != 0)
+	throw std::runtime_error("compressed_sequence: could not write " + filename);
+    }
+
+    // Throws std::runtime_error if the file was not saved by a
+    // compressed_sequence of the same type and codec.
+    static compressed_sequence load(std::string filename) {
+      mapped_file f(filename);
+      header h = file_header();
+      header fh;
+      if (f.size() < sizeof(header) ||
+	  (memcpy(&fh, f.begin(), sizeof(header)),
+	   memcmp(fh.magic, h.magic, 8) != 0 || fh.elt_size != h.elt_size))
+	throw std::runtime_error("compressed_sequence: bad file " + filename);
+      compressed_sequence r;
+      r.n = fh.n;
+      size_t nb = r.num_blocks();
+      size_t ho = sizeof(header);
+      size_t oo = ho + (nb + 1) * sizeof(size_t);
+      if (f.size() != oo + fh.num_bytes)
+	throw std::runtime_error("compressed_sequence: bad file " + filename);
+      r.offsets = sequence<size_t>::no_init(nb + 1);
+      memcpy(r.offsets.begin(), f.begin() + ho, oo - ho);
+      r.bytes = sequence<uint8_t>(fh.num_bytes + padding, [&] (size_t i) {
+	  return (i < fh.num_bytes) ? (uint8_t) f[oo + i] : 0;});
+      return r;
+    }
+
+  private:
+    struct header {
+      char magic[8];
+      uint64_t elt_size, n, num_bytes;
+    };
+
+    static header file_header() {
+      header h;
+      memcpy(h.magic, "PBBSCSQ", 7);
+      h.magic[7] = Codec::id;
+      h.elt_size = sizeof(T);
+      h.n = h.num_bytes = 0;
+      return h;
+    }
+
+    size_t n;
+    sequence<size_t> offsets;  // of each block in bytes, plus the total
+    sequence<uint8_t> bytes;
+  };
+
+  // e.g. auto C = compress<delta_codec>(offsets);
+  template <class Codec, class Seq>
+  compressed_sequence<typename Seq::value_type, Codec>
+  compress(Seq const &A) {
+    return compressed_sequence<typename Seq::value_type, Codec>(A);
+  }
+}
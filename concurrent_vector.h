@@ -0,0 +1,174 @@
+// This code is part of the Problem Based Benchmark Suite (PBBS)
+// Copyright (c) 2011-2019 Guy Blelloch and the PBBS team
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights (to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+// LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// A vector that any number of workers can append to at once, for
+// results whose number is not known ahead of time.
+//
+// Each worker reserves a chunk of slots with a fetch-and-add on a
+// shared counter and then fills it with no synchronization, so
+// emplace_back takes no lock or atomic except once per chunk.  Slots
+// live in buckets of doubling size (bucket k holds base << k of them)
+// that are allocated on first use and never move, so references to
+// elements stay valid.  The order of the elements is the order of the
+// slots, which depends on the schedule.
+//
+// Only the current chunk of each worker can be partly filled, so
+// to_sequence and size (which must not run concurrently with appends)
+// skip at most num_workers() holes.
+
+#pragma once
+
+#include <atomic>
+#include <algorithm>
+#include "sequence.h"
+
+namespace pbbs {
+
+  template <typename T>
+  struct vector {
+  public:
+    using value_type = T;
+    static constexpr size_t base = 1024;
+    static constexpr size_t max_buckets = 48;
+
+    explicit vector(size_t chunk_size = 128)
+      : chunk(std::max<size_t>(chunk_size, 1)), reserved(0),
+	locals(num_workers()) {
+      for (size_t k = 0; k < max_buckets; k++) buckets[k] = nullptr;
+      reset_locals();
+    }
+
+    vector(vector const &) = delete;
+    vector& operator=(vector const &) = delete;
+
+    ~vector() {clear();}
+
+    // Constructs an element in the calling worker's chunk and returns
+    // a reference to it.  Safe to call from any number of workers.
+    template <class... Args>
+    T& emplace_back(Args&&... args) {
+      local &l = locals[worker_id()];
+      if (l.next == l.end) new_chunk(l);
+      T* p = slot(l.next++);
+      new ((void*) p) T(std::forward<Args>(args)...);
+      return *p;
+    }
+
+    T& push_back(T const &a) {return emplace_back(a);}
+    T& push_back(T &&a) {return emplace_back(std::move(a));}
+
+    // The number of elements.  Not safe while appends are in progress.
+    size_t size() const {
+      size_t unused = 0;
+      for (size_t w = 0; w < locals.size(); w++)
+	unused += locals[w].end - locals[w].next;
+      return reserved.load() - unused;
+    }
+
+    // Copies the elements into a sequence, in parallel.  Not safe while
+    // appends are in progress.
+    sequence<T> to_sequence() const {
+      auto parts = filled_ranges();
+      size_t m = parts.size();
+      sequence<size_t> offsets(m + 1, [&] (size_t i) {
+	  return (i == m) ? 0 : parts[i].second - parts[i].first;});
+      size_t n = scan_inplace(offsets.slice(), addm<size_t>());
+      sequence<T> r = sequence<T>::no_init(n);
+      for (size_t j = 0; j < m; j++) {
+	size_t s = parts[j].first, o = offsets[j];
+	parallel_for(0, parts[j].second - s, [&] (size_t i) {
+	    assign_uninitialized(r[o + i], *slot(s + i));}, 1000);
+      }
+      return r;
+    }
+
+    // Destroys the elements and frees the buckets.  Not safe while
+    // appends are in progress.
+    void clear() {
+      if (!std::is_trivially_destructible<T>::value)
+	for (auto r : filled_ranges())
+	  parallel_for(r.first, r.second, [&] (size_t i) {slot(i)->~T();}, 1000);
+      for (size_t k = 0; k < max_buckets; k++) {
+	T* b = buckets[k].load();
+	if (b != nullptr) pbbs::allocator<T>().deallocate(b, base << k);
+	buckets[k] = nullptr;
+      }
+      reset_locals();
+      reserved = 0;
+    }
+
+  private:
+    // the unused part [next, end) of a worker's chunk, padded to a
+    // cache line to avoid false sharing
+    struct local {size_t next, end; char pad[48];};
+
+    size_t chunk;
+    std::atomic<size_t> reserved;
+    std::atomic<T*> buckets[max_buckets];
+    sequence<local> locals;
+
+    void reset_locals() {
+      for (size_t w = 0; w < locals.size(); w++)
+	locals[w].next = locals[w].end = 0;
+    }
+
+    static size_t bucket_of(size_t i) {
+      return 63 - __builtin_clzll(i / base + 1);}
+    static size_t bucket_start(size_t k) {return base * ((((size_t) 1) << k) - 1);}
+
+    T* slot(size_t i) const {
+      size_t k = bucket_of(i);
+      return buckets[k].load(std::memory_order_relaxed) + (i - bucket_start(k));
+    }
+
+    // Reserves the next chunk and makes sure the buckets it covers are
+    // allocated.  If two workers race to allocate a bucket, the loser
+    // frees its copy.
+    void new_chunk(local &l) {
+      size_t s = reserved.fetch_add(chunk);
+      if (bucket_of(s + chunk - 1) >= max_buckets)
+	throw std::length_error("pbbs::vector: too many elements");
+      for (size_t k = bucket_of(s); k <= bucket_of(s + chunk - 1); k++) {
+	if (buckets[k].load() != nullptr) continue;
+	T* b = pbbs::allocator<T>().allocate(base << k);
+	T* expected = nullptr;
+	if (!buckets[k].compare_exchange_strong(expected, b))
+	  pbbs::allocator<T>().deallocate(b, base << k);
+      }
+      l.next = s;
+      l.end = s + chunk;
+    }
+
+    // the ranges of slots that hold elements, in order
+    sequence<std::pair<size_t,size_t>> filled_ranges() const {
+      size_t p = locals.size();
+      auto holes = sequence<std::pair<size_t,size_t>>(p, [&] (size_t w) {
+	  return std::make_pair(locals[w].next, locals[w].end);});
+      std::sort(holes.begin(), holes.end());
+      sequence<std::pair<size_t,size_t>> r(p + 1, [&] (size_t j) {
+	  size_t s = (j == 0) ? 0 : holes[j-1].second;
+	  size_t e = (j == p) ? reserved.load() : holes[j].first;
+	  return std::make_pair(s, std::max(s, e));});
+      return r;
+    }
+  };
+}
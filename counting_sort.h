@@ -233,7 +233,7 @@ namespace pbbs {
   template <typename InS, typename KeyS>
   std::pair<sequence<typename InS::value_type>, sequence<size_t>>
   count_sort(InS const &In, KeyS const &Keys, size_t num_buckets) {
-    sequence<typename InS::value_type> Out(In.size());
+    sequence<typename InS::value_type> Out(In.size(), uninitialized);
     auto a = count_sort(In, Out.slice(), Keys, num_buckets);
     return std::make_pair(std::move(Out), std::move(a.first));
   }
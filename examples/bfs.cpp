@@ -2,6 +2,7 @@
 #include "get_time.h"
 #include "ligra.h"
 #include "parse_command_line.h"
+#include "memory_usage.h"
 
 using namespace pbbs;
 
@@ -46,7 +47,7 @@ std::pair<size_t,size_t> bfs(ligra::graph const &g, vertex start) {
 
 int main (int argc, char *argv[]) {
   commandLine P(argc, argv,
-     "[-r <rounds>] [-t <sparse_dense_ratio>] [-s <source>] filename");
+     "[-r <rounds>] [-mem] [-t <sparse_dense_ratio>] [-s <source>] filename");
   int rounds = P.getOptionIntValue("-r", 1);
   ligra::sparse_dense_ratio = P.getOptionIntValue("-t", 10);
   int start = P.getOptionIntValue("-s", 0);
@@ -62,5 +63,5 @@ int main (int argc, char *argv[]) {
   }
   cout << levels << " levels in BFS, "
        << visited << " vertices visited" << endl;
+  if (P.getOption("-mem")) report_memory("BFS");
 }
-
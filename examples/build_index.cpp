@@ -7,38 +7,49 @@
 // first and then all the line numbers the word appears in.  The words
 // are in alphabetical order, and the line numbers are in integer
 // order, all in ascii.
+// With "-b <binfile>" the index is also saved in the compressed binary
+// format of strings/inverted_index.h, and with "-q <words>" the lines
+// containing all of the (space separated) words are counted.
 
 #include "sequence.h"
 #include "get_time.h"
 #include "strings/string_basics.h"
 #include "parse_command_line.h"
+#include "memory_usage.h"
 #include "group_by.h"
+#include "strings/inverted_index.h"
+#include <sstream>
 using namespace std;
 using namespace pbbs;
 
-// an index consists of a sequence of pairs each consisting of
-//     a character sequence (the word)
-//     an integer sequences (the line numbers it appears in)
-using index_type = sequence<pair<sequence<char>,sequence<size_t>>>;
+// an index consists of
+//     the distinct words, as a nested character sequence
+//     for each word, the line numbers it appears in
+// both stored flat (see nested_sequence.h)
+struct index_type {
+  nested_sequence<char> words;
+  nested_sequence<size_t> lines;
+  size_t size() const {return words.size();}
+};
 
-auto build_index(sequence<char> const &str, bool verbose) -> index_type {
+index_type build_index(sequence<char> const &str, bool verbose) {
   timer t("build_index", verbose); // set to true to print times for each step
-  auto is_line_break = [&] (char a) {return a == '\n' || a == '\r';};
-  auto is_space = [&] (char a) {return a == ' ' || a == '\t';};
+  char_set is_line_break("\n\r");
+  char_set is_space(" \t");
   
   // remove punctuation and convert to lower case
   sequence<char> cleanstr = map(str, [&] (char a) -> char {
       return isspace(a) ? a : isalpha(a) ? tolower(a) : ' ';});
   t.next("clean");
   
-  // split into lines
-  auto lines = split(cleanstr, is_line_break);
+  // split into lines, as ranges pointing into cleanstr
+  auto lines = split_ranges(cleanstr, is_line_break);
   t.next("split");
   
   // generate sequence of sequences of (token, line_number) pairs
-  // tokens are strings separated by spaces.
+  // tokens are strings separated by spaces, and are also ranges
   auto pairs = tabulate(lines.size(), [&] (size_t i) {
-      return dmap(tokens(lines[i], is_space), [=] (sequence<char> s) {
+      return dmap(token_ranges(lines[i], is_space), [=] (range<char*> s) {
 	  return make_pair(s, i);});
       });
   t.next("tokens");
@@ -48,14 +59,19 @@ auto build_index(sequence<char> const &str, bool verbose) -> index_type {
   t.next("flatten");
       
   // group line numbers by tokens
-  return group_by(flat_pairs);
+  auto [words, line_numbers] = group_by_nested(flat_pairs);
+  t.next("group by");
+
+  // copy out just the distinct words, since cleanstr goes away
+  return index_type{nested_sequence<char>::from_nested(words),
+		    std::move(line_numbers)};
 }
 
 // converts an index into an ascii character sequence ready for output
 sequence<char> index_to_char_seq(index_type const &idx) {
 
   // print line numbers separated by spaces for a singe word
-  auto linelist = [] (auto &A) {
+  auto linelist = [] (auto const &A) {
     return flatten(tabulate(2 * A.size(), [&] (size_t i) {
 	  if (i & 1) return to_char_seq(A[i/2]);
 	  return singleton(' ');
@@ -63,18 +79,20 @@ sequence<char> index_to_char_seq(index_type const &idx) {
   };
 
   // for each entry, print word followed by list of lines it is in
-  return flatten(map(idx, [&] (auto& entry) {
-	sequence<sequence<char>>&& A = {entry.first,
-					linelist(entry.second),
+  return flatten(tabulate(idx.size(), [&] (size_t i) {
+	sequence<sequence<char>>&& A = {sequence<char>(idx.words[i]),
+					linelist(idx.lines[i]),
 					singleton('\n')};
 	return flatten(A);}));
 }
 
 int main (int argc, char *argv[]) {
-  commandLine P(argc, argv, "[-r <rounds>] [-o <outfile>] infile");
+  commandLine P(argc, argv, "[-r <rounds>] [-mem] [-o <outfile>] [-b <binfile>] [-q <words>] infile");
   int rounds = P.getOptionIntValue("-r", 1);
   bool verbose = P.getOption("-v");
   std::string outfile = P.getOptionValue("-o", "");
+  std::string binfile = P.getOptionValue("-b", "");
+  std::string query = P.getOptionValue("-q", "");
   char* filename = P.getArgument(0);
   timer idx_timer("build_index", verbose);
   auto str = pbbs::char_range_from_file(filename);
@@ -93,7 +111,7 @@ int main (int argc, char *argv[]) {
     idx_timer.next("build index");
   }
 
-  cout << (idx[0].second)[2] << endl;
+  cout << idx.lines[0][2] << endl;
 
   if (outfile.size() > 0) {
     auto out_str = index_to_char_seq(idx);
@@ -104,4 +122,22 @@ int main (int argc, char *argv[]) {
   } else {
     cout << "number of distinct words: " << idx.size() << endl;
   }
+  if (binfile.size() > 0 || query.size() > 0) {
+    auto inv = build_inverted_index(delayed_seq<pair<range<char*>,range<size_t*>>>(
+        idx.size(), [&] (size_t i) {
+	  return make_pair(idx.words[i], idx.lines[i]);}));
+    idx_timer.next("compress index");
+    if (binfile.size() > 0) {
+      inv.save(binfile);
+      idx_timer.next("write binary index");
+    }
+    if (query.size() > 0) {
+      std::vector<std::string> words;
+      std::istringstream ws(query);
+      for (std::string w; ws >> w; ) words.push_back(w);
+      cout << "lines with all words: " << inv.query_and(words).size() << endl;
+      idx_timer.next("query");
+    }
+  }
+  if (P.getOption("-mem")) report_memory("build_index");
 }
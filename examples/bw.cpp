@@ -5,8 +5,10 @@
 #include "strings/suffix_array.h"
 #include "strings/lcp.h"
 #include "parse_command_line.h"
+#include "memory_usage.h"
 #include "random.h"
 #include "stlalgs.h"
+#include "strings/entropy_coding.h"
 
 using namespace pbbs;
 
@@ -35,13 +37,11 @@ std::pair<size_t, range<uchar*>> split_head(sequence<uchar> const &s) {
   return std::make_pair(head, s.slice(l+1, s.size()));
 }
 
+// inverts the transform ss, where head is the location of the first
+// character of the original string
 template <class Int>
-sequence<uchar> bw_transform_reverse_(sequence<uchar> const &s) {
+sequence<uchar> bw_transform_reverse_(range<uchar*> ss, Int head) {
   timer t("trans", false);
-
-  Int head;
-  range<uchar*> ss;
-  std::tie(head, ss) = split_head(s);
   Int n = ss.size();
 
   // Set head location to 0 temporarily so when sorted it ends up
@@ -60,7 +60,7 @@ sequence<uchar> bw_transform_reverse_(sequence<uchar> const &s) {
   Int block_size = 1 << block_bits;
   pbbs::random r(0);
   auto links = sorted.first;
-  sequence<bool> head_flags(n, false);
+  sequence<bool> head_flags(n, zeroed);
 
   // pick a set of random locations as heads (each with prob 1/block_size).
   // links that point to a head are set to their original position + n
@@ -123,18 +123,50 @@ sequence<uchar> bw_transform_reverse_(sequence<uchar> const &s) {
   return res;
 }
 
-sequence<uchar> bw_transform_reverse(sequence<uchar> const &s) {
-  if (s.size() >= (((long) 1) << 31))
-    return bw_transform_reverse_<unsigned long>(s);
+sequence<uchar> bw_transform_reverse(range<uchar*> ss, size_t head) {
+  if (ss.size() >= (((long) 1) << 31))
+    return bw_transform_reverse_<unsigned long>(ss, head);
   else
-    return bw_transform_reverse_<unsigned int>(s);
+    return bw_transform_reverse_<unsigned int>(ss, head);
+}
+
+sequence<uchar> bw_transform_reverse(sequence<uchar> const &s) {
+  size_t head;
+  range<uchar*> ss;
+  std::tie(head, ss) = split_head(s);
+  return bw_transform_reverse(ss, head);
+}
+
+// The transform followed by move-to-front, run-length and Huffman
+// coding (see strings/entropy_coding.h), with the head location first
+sequence<uchar> bw_compress(sequence<uchar> const &s) {
+  sequence<uchar> bwt;
+  size_t loc;
+  std::tie(bwt, loc) = bw_transform<uint>(s);
+  auto prefix = to_char_seq(loc);
+  sequence<char> coded = entropy_encode(bwt);
+  sequence<sequence<uchar>> parts = {
+    map(prefix, [] (char c) {return (uchar) c;}),
+    singleton((uchar) ':'),
+    map(coded, [] (char c) {return (uchar) c;})};
+  return flatten(parts);
+}
+
+sequence<uchar> bw_decompress(sequence<uchar> const &s) {
+  size_t head;
+  range<uchar*> ss;
+  std::tie(head, ss) = split_head(s);
+  sequence<uchar> bwt = entropy_decode(range<char*>((char*) ss.begin(),
+						    (char*) ss.end()));
+  return bw_transform_reverse(bwt.slice(), head);
 }
   
 int main (int argc, char *argv[]) {
-  commandLine P(argc, argv, "[-r <rounds>] [-o] infile");
+  commandLine P(argc, argv, "[-r <rounds>] [-mem] [-o] [-d] [-c] infile");
   int rounds = P.getOptionIntValue("-r", 1);
   bool output = P.getOption("-o");
   bool detrans = P.getOption("-d");
+  bool compress = P.getOption("-c");
   char* filename = P.getArgument(0);
   timer t("bw", !output);
 
@@ -146,17 +178,26 @@ int main (int argc, char *argv[]) {
   sequence<uchar> out;
     
   for (int i=0; i < rounds; i++) {
-    if (detrans)
+    if (compress && detrans)
+      out = bw_decompress(str);
+    else if (compress)
+      out = bw_compress(str);
+    else if (detrans)
       out = bw_transform_reverse(str);
     else 
       std::tie(out, loc) = bw_transform<uint>(str);
-    t.next("calculate bw transform");
+    t.next(compress ? (detrans ? "decompress" : "compress")
+	   : "calculate bw transform");
   }
-  
+  if (compress && !output)
+    cout << (detrans ? "decompressed size: " : "compressed size: ")
+	 << out.size() << endl;
+
   if (output) {
     auto ostr = map(out, [&] (uchar c) {return (char) c;});
-    if (!detrans)
+    if (!detrans && !compress)
       cout << loc << ':';
-    cout << ostr;
+    char_seq_to_stream(ostr, cout);
   }
+  if (P.getOption("-mem")) report_memory("bw");
 }
@@ -1,41 +1,63 @@
+// Grep.
+// Prints the lines of a file that contain the search string.
+// With -E the search string is a regular expression (see
+// strings/string_search.h for the syntax), and with -f the file
+// gives a set of strings, one per line, any of which can match.
+
 #include "sequence.h"
 #include "get_time.h"
 #include "strings/string_basics.h"
+#include "strings/string_search.h"
 #include "parse_command_line.h"
-#include "group_by.h"
+#include "memory_usage.h"
 
 using namespace pbbs;
 
+// returns the matching lines, each followed by a line break
+template <class Matcher>
+sequence<char> grep(range<char*> str, Matcher const &m) {
+  static char cr = '\n';
+  // the lines are ranges into str, so are not copied until flatten
+  auto lines = grep_lines(str, m);
+  return flatten(tabulate(lines.size()*2, [&] (size_t i) {
+	return (i & 1) ? range<char*>(&cr, &cr + 1) : lines[i/2];}));
+}
+
 int main (int argc, char *argv[]) {
-  commandLine P(argc, argv, "[-r <rounds>] search_string infile");
+  commandLine P(argc, argv,
+		"[-r <rounds>] [-mem] [-E] [-f <pattern_file>] search_string infile");
   int rounds = P.getOptionIntValue("-r", 1);
-  auto search_str = to_sequence(std::string(P.getArgument(1)));
+  bool regex = P.getOption("-E");
+  std::string pattern_file = P.getOptionValue("-f", "");
   char* filename = P.getArgument(0);
 
   timer t("grep", true);
-  
-  pbbs::range<char*> str = pbbs::char_range_from_file(filename);
+
+  pbbs::range<char*> str = pbbs::char_range_from_file(filename, fl_map_prefault);
   t.next("read file");
   sequence<char> out_str;
 
-  for (int i=0; i < rounds; i++) {
-    // auto foo = pack_index<size_t>(seq(str.size(), [&] (size_t i) {
-    // 	  return str[i] == '\n';}));
-    // size_t l = str.size() - search_str.size() + 1;
-    // auto bar = pack_index<size_t>(seq(l, [&] (size_t i) {
-    // 	  size_t j;
-    // 	  for (j=0; j < search_str.size(); j++)
-    // 	    if (str[i+j] != search_str[j]) break;
-    // 	  return (j == search_str.size());
-    // 	}));
-    auto is_line_break = [&] (char a) {return a == '\n';};
-    auto cr = singleton('\n');
-    auto lines = filter(split(str, is_line_break), [&] (auto const &s) {
-    	return search(s, search_str) < s.size();});
-    out_str = flatten(tabulate(lines.size()*2, [&] (size_t i) {
-    	  return (i & 1) ? cr : std::move(lines[i/2]);}));
-    t.next("do work");
+  auto run = [&] (auto const &m) {
+    t.next("build matcher");
+    for (int i=0; i < rounds; i++) {
+      out_str = grep(str, m);
+      t.next("do work");
+    }
+  };
+
+  if (pattern_file.size() > 0) {
+    mapped_file pf(pattern_file);
+    auto lines = split_ranges(pf, char_set("\n"));
+    std::vector<std::string> patterns;
+    for (size_t i = 0; i < lines.size(); i++)
+      if (lines[i].size() > 0)
+	patterns.push_back(std::string(lines[i].begin(), lines[i].end()));
+    run(multi_string_matcher(patterns));
+  } else {
+    std::string search_str(P.getArgument(1));
+    if (regex) run(regex_matcher(search_str));
+    else run(string_matcher(search_str));
   }
   cout << out_str;
+  if (P.getOption("-mem")) report_memory("grep");
 }
-
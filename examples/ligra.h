@@ -43,7 +43,7 @@ namespace ligra {
     bool is_empty() {return size() == 0;}
     sequence<bool> get_flags(size_t n) const {
       if (is_dense) return flags;
-      sequence<bool> r(n, false);
+      sequence<bool> r(n, zeroed);
       parallel_for (0, indices.size(), [&] (size_t i) {
 	  r[indices[i]] = true;});
       return r;
@@ -60,18 +60,22 @@ namespace ligra {
   // **************************************************************
 
   graph read_graph(char* filename) {
-    sequence<char> str = char_range_from_file(filename);
-    auto is_space = [&] (char a) {return a == ' ' || a == '\n';};
-    auto words = tokenize(str, is_space);
-    size_t n = atol(words[1]); // num_vertices
-    size_t m = atol(words[2]);  // num_edges
-    if (3 + n + m != words.size() && (3 + n + 2*m != words.size()))
+    pbbs::mapped_file str(filename);
+    // skip the header (e.g. AdjacencyGraph), the rest is numbers
+    size_t start = 0;
+    while (start < str.size() && !pbbs::is_number_space(str[start])) start++;
+    auto nums = pbbs::parse_numbers<size_t>(str.slice(start, str.size()));
+    if (nums.size() < 2)
+      throw std::runtime_error("Badly formatted file in read_graph");
+    size_t n = nums[0]; // num_vertices
+    size_t m = nums[1];  // num_edges
+    if (2 + n + m != nums.size() && (2 + n + 2*m != nums.size()))
       throw std::runtime_error("Badly formatted file in read_graph");
     graph g;
-    g.offsets = map(words.slice(3,3+n), [&] (auto &s) {
-	return (edge_index) atol(s);});
-    g.edges = map(words.slice(3+n,3+n+m), [&] (auto &s)  {
-	return (vertex) atol(s);});
+    g.offsets = map(nums.slice(2,2+n), [&] (size_t s) {
+	return (edge_index) s;});
+    g.edges = map(nums.slice(2+n,2+n+m), [&] (size_t s)  {
+	return (vertex) s;});
     return g;
   }
 
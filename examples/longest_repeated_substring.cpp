@@ -4,6 +4,7 @@
 #include "strings/suffix_array.h"
 #include "strings/lcp.h"
 #include "parse_command_line.h"
+#include "memory_usage.h"
 
 using namespace pbbs;
 
@@ -27,7 +28,7 @@ tuple<uint,uint,uint> lrs(sequence<uchar> const &s) {
 }
 
 int main (int argc, char *argv[]) {
-  commandLine P(argc, argv, "[-r <rounds>] infile");
+  commandLine P(argc, argv, "[-r <rounds>] [-mem] infile");
   int rounds = P.getOptionIntValue("-r", 1);
   int output = P.getOption("-o");
   char* filename = P.getArgument(0);
@@ -52,4 +53,5 @@ int main (int argc, char *argv[]) {
     cout << (sequence<char>(len, [&] (size_t i) -> char {
 	  return str[match1 + i];})) << endl;
   }
+  if (P.getOption("-mem")) report_memory("lrs");
 }
@@ -2,6 +2,7 @@
 #include "random.h"
 #include "get_time.h"
 #include "parse_command_line.h"
+#include "memory_usage.h"
 
 using namespace std;
 using namespace pbbs;
@@ -12,24 +13,25 @@ using namespace pbbs;
 template <class Seq>
 typename Seq::value_type mcss(Seq const &A) {
   using T = typename Seq::value_type;
-  using TT = tuple<T,T,T,T>;
-  auto f = [&] (TT a, TT b) {
-    T aa, pa, sa, ta, ab, pb, sb, tb;
-    tie(aa, pa, sa, ta) = a;
-    tie(ab, pb, sb, tb) = b;
-    return TT(max(aa,max(ab,sa+pb)),
-	      max(pa, ta+pb),
-	      max(sa + ab, sb),
-	      ta + tb);
-  };
-  auto S = delayed_seq<TT>(A.size(), [&] (size_t i) {
-      return TT(A[i],A[i],A[i],A[i]);});
-  TT r = reduce(S, make_monoid(f, TT(0,0,0,0)));
-  return get<0>(r);
+  using M = mcssm<T>;
+  auto S = delayed_seq<typename M::T>(A.size(), [&] (size_t i) {
+      return M::single(A[i]);});
+  return get<0>(reduce(S, M()));
+}
+
+// also returns where the subsequence is
+template <class Seq>
+auto mcss_interval(Seq const &A) {
+  using T = typename Seq::value_type;
+  using M = mcss_intervalm<T>;
+  auto S = delayed_seq<typename M::T>(A.size(), [&] (size_t i) {
+      return M::single(A[i], i);});
+  return reduce(S, M());
 }
 
 int main (int argc, char *argv[]) {
-  commandLine P(argc, argv, "[-r <rounds>] [-n <size>]");
+  commandLine P(argc, argv, "[-r <rounds>] [-mem] [-i] [-n <size>]");
+  bool interval = P.getOption("-i");
   int rounds = P.getOptionIntValue("-r", 3);
   size_t n = 100000000;
   n = P.getOptionLongValue("-n", 1);
@@ -40,8 +42,17 @@ int main (int argc, char *argv[]) {
   sequence<T> A(n, [&] (size_t i) {return (T) (r[i]%n - n/2);});
   T result;
   for (int i=0; i < rounds; i++) {
-    result = mcss(A);
-    t.next("Total");
+    if (interval) {
+      auto r = mcss_interval(A);
+      result = r.best;
+      t.next("Total");
+      if (i == rounds - 1)
+	cout << "from " << r.best_lo << " to " << r.best_hi << ": ";
+    } else {
+      result = mcss(A);
+      t.next("Total");
+    }
   }
   cout << result << endl;
+  if (P.getOption("-mem")) report_memory("MCSS");
 }
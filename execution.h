@@ -0,0 +1,379 @@
+// This code is part of the Problem Based Benchmark Suite (PBBS)
+// Copyright (c) 2011-2019 Guy Blelloch and the PBBS team
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights (to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+// LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// An execution policy pbbs::execution::par, and overloads of the
+// common parallel standard algorithms taking it, so code written
+// against std::execution::par runs on the pbbs scheduler instead of
+// the standard library's backend.  Call sites only change the
+// namespace, e.g.
+//
+//   std::sort(std::execution::par, v.begin(), v.end());
+//
+// becomes
+//
+//   pbbs::execution::sort(pbbs::execution::par, v.begin(), v.end());
+//
+// or, since the overloads are found by argument dependent lookup,
+// just sort(pbbs::execution::par, ...).  The semantics are those of
+// the standard versions: iterators must be random access, reduce and
+// the scans assume the operation is associative (reduce also that it
+// is commutative) and do not need an identity, and the sorts (which
+// use sample_sort) and the output of merge need contiguous storage.
+
+#pragma once
+
+#include <iterator>
+#include <functional>
+#include "sequence.h"
+#include "sample_sort.h"
+#include "merge.h"
+#include "stlalgs.h"
+
+namespace pbbs {
+namespace execution {
+
+  struct parallel_policy {};
+  constexpr parallel_policy par{};
+  constexpr parallel_policy par_unseq{};
+
+  template <class Iter>
+  using value_type_of = typename std::iterator_traits<Iter>::value_type;
+
+  // a read-only Seq over [first, last), which works for const iterators
+  template <class Iter>
+  auto in_seq(Iter first, Iter last) {
+    return delayed_seq<value_type_of<Iter>>(last - first, [=] (size_t i) {
+	return first[i];});
+  }
+
+  // Folds get(0), ..., get(n-1) into init.  Each block is folded from
+  // its first element, so op needs no identity.
+  template <class T, class Get, class Op>
+  T reduce_op_(size_t n, Get const &get, T init, Op const &op) {
+    size_t l = num_blocks(n, _block_size);
+    if (l <= 1) {
+      for (size_t i = 0; i < n; i++) init = op(init, get(i));
+      return init;
+    }
+    sequence<T> Sums(l, uninitialized);
+    sliced_for(n, _block_size, [&] (size_t i, size_t s, size_t e) {
+	T r = get(s);
+	for (size_t j = s + 1; j < e; j++) r = op(r, get(j));
+	assign_uninitialized(Sums[i], std::move(r));});
+    for (size_t i = 0; i < l; i++) init = op(init, Sums[i]);
+    return init;
+  }
+
+  // Writes the inclusive or exclusive scan of get(0), ..., get(n-1)
+  // starting from *init (nothing if null, inclusive only) to out,
+  // which can alias the input.  Like reduce_op_, op needs no identity.
+  template <class T, class Get, class OutIter, class Op>
+  void scan_op_(size_t n, Get const &get, OutIter out, Op const &op,
+		T const *init, bool inclusive) {
+    auto scan_block = [&] (size_t s, size_t e, T const *offset) {
+      if (s == e) return;
+      if (inclusive) {
+	T r = offset ? op(*offset, get(s)) : T(get(s));
+	out[s] = r;
+	for (size_t j = s + 1; j < e; j++) out[j] = r = op(r, get(j));
+      } else {
+	T r = *offset;
+	for (size_t j = s; j < e; j++) {
+	  T t = get(j);
+	  out[j] = r;
+	  r = op(r, t);
+	}
+      }
+    };
+    size_t l = num_blocks(n, _block_size);
+    if (l <= 1) {scan_block(0, n, init); return;}
+    sequence<T> Sums(l, uninitialized);
+    sliced_for(n, _block_size, [&] (size_t i, size_t s, size_t e) {
+	T r = get(s);
+	for (size_t j = s + 1; j < e; j++) r = op(r, get(j));
+	assign_uninitialized(Sums[i], std::move(r));});
+    // Sums[i] becomes the total before block i+1
+    if (init) Sums[0] = op(*init, Sums[0]);
+    for (size_t i = 1; i < l; i++) Sums[i] = op(Sums[i-1], Sums[i]);
+    sliced_for(n, _block_size, [&] (size_t i, size_t s, size_t e) {
+	scan_block(s, e, (i == 0) ? init : &Sums[i-1]);});
+  }
+
+  // ***** sorting and merging *****
+
+  // the contiguous storage [first, last) as a range of pointers, as
+  // needed by the sorts and merge
+  template <class Iter>
+  range<value_type_of<Iter>*> contiguous(Iter first, size_t n) {
+    value_type_of<Iter>* p = (n == 0) ? nullptr : &*first;
+    return range<value_type_of<Iter>*>(p, p + n);
+  }
+
+  template <class RandomIt, class Compare>
+  void sort(parallel_policy, RandomIt first, RandomIt last, Compare comp) {
+    sample_sort_inplace(contiguous(first, last - first), comp);}
+
+  template <class RandomIt>
+  void sort(parallel_policy p, RandomIt first, RandomIt last) {
+    sort(p, first, last, std::less<value_type_of<RandomIt>>());}
+
+  template <class RandomIt, class Compare>
+  void stable_sort(parallel_policy, RandomIt first, RandomIt last,
+		   Compare comp) {
+    sample_sort_inplace(contiguous(first, last - first), comp, true);}
+
+  template <class RandomIt>
+  void stable_sort(parallel_policy p, RandomIt first, RandomIt last) {
+    stable_sort(p, first, last, std::less<value_type_of<RandomIt>>());}
+
+  template <class It1, class It2, class OutIt, class Compare>
+  OutIt merge(parallel_policy, It1 first1, It1 last1, It2 first2, It2 last2,
+	      OutIt d_first, Compare comp) {
+    size_t n = (last1 - first1) + (last2 - first2);
+    merge_<_assign>(in_seq(first1, last1), in_seq(first2, last2),
+		    contiguous(d_first, n), comp);
+    return d_first + n;
+  }
+
+  template <class It1, class It2, class OutIt>
+  OutIt merge(parallel_policy p, It1 first1, It1 last1, It2 first2, It2 last2,
+	      OutIt d_first) {
+    return merge(p, first1, last1, first2, last2, d_first,
+		 std::less<value_type_of<It1>>());}
+
+  // ***** element-wise *****
+
+  template <class It, class UnaryFunction>
+  void for_each(parallel_policy, It first, It last, UnaryFunction f) {
+    parallel_for(0, last - first, [&] (size_t i) {f(first[i]);});}
+
+  template <class It, class Size, class UnaryFunction>
+  It for_each_n(parallel_policy p, It first, Size n, UnaryFunction f) {
+    for_each(p, first, first + n, f);
+    return first + n;
+  }
+
+  template <class InIt, class OutIt, class UnaryOp>
+  OutIt transform(parallel_policy, InIt first, InIt last, OutIt d_first,
+		  UnaryOp op) {
+    size_t n = last - first;
+    parallel_for(0, n, [&] (size_t i) {d_first[i] = op(first[i]);});
+    return d_first + n;
+  }
+
+  template <class InIt1, class InIt2, class OutIt, class BinaryOp>
+  OutIt transform(parallel_policy, InIt1 first1, InIt1 last1, InIt2 first2,
+		  OutIt d_first, BinaryOp op) {
+    size_t n = last1 - first1;
+    parallel_for(0, n, [&] (size_t i) {
+	d_first[i] = op(first1[i], first2[i]);});
+    return d_first + n;
+  }
+
+  template <class It, class T>
+  void fill(parallel_policy, It first, It last, T const &value) {
+    parallel_for(0, last - first, [&] (size_t i) {first[i] = value;});}
+
+  template <class InIt, class OutIt>
+  OutIt copy(parallel_policy, InIt first, InIt last, OutIt d_first) {
+    size_t n = last - first;
+    parallel_for(0, n, [&] (size_t i) {d_first[i] = first[i];});
+    return d_first + n;
+  }
+
+  // Same blocked count, scan and copy as filter_out, but assigning to
+  // the (already constructed) output.
+  template <class InIt, class OutIt, class UnaryPred>
+  OutIt copy_if(parallel_policy, InIt first, InIt last, OutIt d_first,
+		UnaryPred pred) {
+    size_t n = last - first;
+    size_t l = num_blocks(n, _block_size);
+    sequence<size_t> Sums(l, uninitialized);
+    sliced_for(n, _block_size, [&] (size_t i, size_t s, size_t e) {
+	size_t r = 0;
+	for (size_t j = s; j < e; j++) r += (bool) pred(first[j]);
+	Sums[i] = r;});
+    size_t m = scan_inplace(Sums.slice(), addm<size_t>());
+    sliced_for(n, _block_size, [&] (size_t i, size_t s, size_t e) {
+	size_t k = Sums[i];
+	for (size_t j = s; j < e; j++)
+	  if (pred(first[j])) d_first[k++] = first[j];});
+    return d_first + m;
+  }
+
+  template <class InIt, class OutIt, class UnaryPred>
+  OutIt remove_copy_if(parallel_policy p, InIt first, InIt last, OutIt d_first,
+		       UnaryPred pred) {
+    return copy_if(p, first, last, d_first, [&] (auto const &a) {
+	return !pred(a);});
+  }
+
+  // ***** reductions and scans *****
+
+  template <class It, class T, class BinaryOp>
+  T reduce(parallel_policy, It first, It last, T init, BinaryOp op) {
+    return reduce_op_(last - first, [&] (size_t i) -> T {return first[i];},
+		      init, op);
+  }
+
+  template <class It, class T>
+  T reduce(parallel_policy p, It first, It last, T init) {
+    return reduce(p, first, last, init, std::plus<>());}
+
+  template <class It>
+  value_type_of<It> reduce(parallel_policy p, It first, It last) {
+    return reduce(p, first, last, value_type_of<It>());}
+
+  template <class It, class T, class BinaryReduce, class UnaryTransform>
+  T transform_reduce(parallel_policy, It first, It last, T init,
+		     BinaryReduce reduce_op, UnaryTransform transform_op) {
+    return reduce_op_(last - first, [&] (size_t i) -> T {
+	return transform_op(first[i]);}, init, reduce_op);
+  }
+
+  template <class It1, class It2, class T, class BinaryReduce,
+	    class BinaryTransform>
+  T transform_reduce(parallel_policy, It1 first1, It1 last1, It2 first2,
+		     T init, BinaryReduce reduce_op,
+		     BinaryTransform transform_op) {
+    return reduce_op_(last1 - first1, [&] (size_t i) -> T {
+	return transform_op(first1[i], first2[i]);}, init, reduce_op);
+  }
+
+  // the inner product
+  template <class It1, class It2, class T>
+  T transform_reduce(parallel_policy p, It1 first1, It1 last1, It2 first2,
+		     T init) {
+    return transform_reduce(p, first1, last1, first2, init, std::plus<>(),
+			    std::multiplies<>());
+  }
+
+  template <class InIt, class OutIt, class BinaryOp, class T>
+  OutIt inclusive_scan(parallel_policy, InIt first, InIt last, OutIt d_first,
+		       BinaryOp op, T init) {
+    size_t n = last - first;
+    scan_op_(n, [&] (size_t i) -> T {return first[i];}, d_first, op,
+	     &init, true);
+    return d_first + n;
+  }
+
+  template <class InIt, class OutIt, class BinaryOp>
+  OutIt inclusive_scan(parallel_policy, InIt first, InIt last, OutIt d_first,
+		       BinaryOp op) {
+    using T = value_type_of<InIt>;
+    size_t n = last - first;
+    scan_op_(n, [&] (size_t i) -> T {return first[i];}, d_first, op,
+	     (T const *) nullptr, true);
+    return d_first + n;
+  }
+
+  template <class InIt, class OutIt>
+  OutIt inclusive_scan(parallel_policy p, InIt first, InIt last,
+		       OutIt d_first) {
+    return inclusive_scan(p, first, last, d_first, std::plus<>());}
+
+  template <class InIt, class OutIt, class T, class BinaryOp>
+  OutIt exclusive_scan(parallel_policy, InIt first, InIt last, OutIt d_first,
+		       T init, BinaryOp op) {
+    size_t n = last - first;
+    scan_op_(n, [&] (size_t i) -> T {return first[i];}, d_first, op,
+	     &init, false);
+    return d_first + n;
+  }
+
+  template <class InIt, class OutIt, class T>
+  OutIt exclusive_scan(parallel_policy p, InIt first, InIt last, OutIt d_first,
+		       T init) {
+    return exclusive_scan(p, first, last, d_first, init, std::plus<>());}
+
+  // ***** searching and counting (see stlalgs.h) *****
+
+  template <class It, class UnaryPred>
+  It find_if(parallel_policy, It first, It last, UnaryPred pred) {
+    return first + find_if_index(last - first, [&] (size_t i) {
+	return pred(first[i]);});
+  }
+
+  template <class It, class UnaryPred>
+  It find_if_not(parallel_policy p, It first, It last, UnaryPred pred) {
+    return find_if(p, first, last, [&] (auto const &a) {return !pred(a);});}
+
+  template <class It, class T>
+  It find(parallel_policy p, It first, It last, T const &value) {
+    return find_if(p, first, last, [&] (auto const &a) {return a == value;});}
+
+  template <class It, class UnaryPred>
+  bool any_of(parallel_policy, It first, It last, UnaryPred pred) {
+    return pbbs::any_of(in_seq(first, last), pred);}
+
+  template <class It, class UnaryPred>
+  bool all_of(parallel_policy, It first, It last, UnaryPred pred) {
+    return pbbs::all_of(in_seq(first, last), pred);}
+
+  template <class It, class UnaryPred>
+  bool none_of(parallel_policy, It first, It last, UnaryPred pred) {
+    return pbbs::none_of(in_seq(first, last), pred);}
+
+  template <class It, class UnaryPred>
+  size_t count_if(parallel_policy, It first, It last, UnaryPred pred) {
+    return count_if_index(last - first, [&] (size_t i) {
+	return (bool) pred(first[i]);});
+  }
+
+  template <class It, class T>
+  size_t count(parallel_policy p, It first, It last, T const &value) {
+    return count_if(p, first, last, [&] (auto const &a) {return a == value;});}
+
+  template <class It1, class It2, class BinaryPred>
+  std::pair<It1,It2> mismatch(parallel_policy, It1 first1, It1 last1,
+			      It2 first2, BinaryPred pred) {
+    size_t i = find_if_index(last1 - first1, [&] (size_t i) {
+	return !pred(first1[i], first2[i]);});
+    return std::make_pair(first1 + i, first2 + i);
+  }
+
+  template <class It1, class It2>
+  std::pair<It1,It2> mismatch(parallel_policy p, It1 first1, It1 last1,
+			      It2 first2) {
+    return mismatch(p, first1, last1, first2, std::equal_to<>());}
+
+  template <class It1, class It2>
+  bool equal(parallel_policy p, It1 first1, It1 last1, It2 first2) {
+    return mismatch(p, first1, last1, first2).first == last1;}
+
+  template <class It, class Compare>
+  It min_element(parallel_policy, It first, It last, Compare comp) {
+    return first + pbbs::min_element(in_seq(first, last), comp);}
+
+  template <class It>
+  It min_element(parallel_policy p, It first, It last) {
+    return min_element(p, first, last, std::less<value_type_of<It>>());}
+
+  template <class It, class Compare>
+  It max_element(parallel_policy, It first, It last, Compare comp) {
+    return first + pbbs::max_element(in_seq(first, last), comp);}
+
+  template <class It>
+  It max_element(parallel_policy p, It first, It last) {
+    return max_element(p, first, last, std::less<value_type_of<It>>());}
+}
+}
@@ -5,6 +5,108 @@
 #include <iomanip>
 #include <iostream>
 #include <string>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <unordered_map>
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
+// ****************************************
+//    phase_profiler
+// ****************************************
+
+// Aggregates the phases reported through timer::next across all calls
+// into a hierarchy, e.g. "Suffix Array;sort;sample sort;transpose".
+// Enabled by setting the environment variable PBBS_PROFILE to a file
+// name, or to 1 to write to stderr.  At exit it writes one line per
+// phase in the collapsed stack format used by flamegraph.pl: the path
+// followed by the self time in microseconds (i.e. excluding nested phases).
+//
+// Similarly PBBS_PROFILE_MEM writes the change in bytes held by the
+// allocator across each phase (as returned by memory, which alloc.h sets).
+//
+// A timer created while another is live on the same thread is nested
+// within the phase of the outer timer that it ends up in (i.e. the name
+// given to the next call of next() on the outer timer).  Timers created
+// on other threads (e.g. within a parallel_for) appear at the root, as do
+// all timers under cilk, since continuations can move between threads.
+struct phase_profiler {
+  using totals_map = std::unordered_map<std::string,double>;
+  bool on, mem_on;
+  std::string out, mem_out;
+  std::function<long()> memory;
+  std::mutex mtx;
+  totals_map totals, mem_totals;
+
+  static phase_profiler& get() {
+    static phase_profiler p;
+    return p;
+  }
+
+  static bool enabled() {return get().on || get().mem_on;}
+
+  static bool env_on(const char* name, std::string &value) {
+    const char* e = std::getenv(name);
+    if ((e == NULL) || (strlen(e) == 0) || (strcmp(e, "0") == 0)) return false;
+    value = e;
+    return true;
+  }
+
+  phase_profiler() {
+    on = env_on("PBBS_PROFILE", out);
+    mem_on = env_on("PBBS_PROFILE_MEM", mem_out);
+  }
+
+  long current_memory() {return (mem_on && memory) ? memory() : 0;}
+
+  // thread safe
+  void add(std::string const &path, double t, double m) {
+    std::lock_guard<std::mutex> lock(mtx);
+    totals[path] += t;
+    mem_totals[path] += m;
+  }
+
+  // Self times can come out slightly negative (e.g. children that ran
+  // in parallel), so with clamp they are reported as at least 0.  Memory
+  // deltas are not clamped since a phase can free memory.
+  static void report(totals_map const &tots, std::ostream& os, double scale,
+		     bool clamp) {
+    totals_map self = tots;
+    // subtract each phase from its nearest recorded ancestor
+    for (auto const &p : tots) {
+      size_t l = p.first.size();
+      while ((l = p.first.rfind(';', l-1)) != std::string::npos && l > 0) {
+	auto parent = self.find(p.first.substr(0, l));
+	if (parent != self.end()) {parent->second -= p.second; break;}
+      }
+    }
+    std::vector<std::pair<std::string,double>> sorted(self.begin(), self.end());
+    std::sort(sorted.begin(), sorted.end());
+    for (auto const &p : sorted)
+      os << p.first << " "
+	 << (long) ((clamp ? std::max(p.second, 0.0) : p.second) * scale) << "\n";
+    os.flush();
+  }
+
+  static void write(totals_map const &tots, std::string const &out,
+		    double scale, bool clamp) {
+    if (out == "1") report(tots, std::cerr, scale, clamp);
+    else {
+      std::ofstream os(out);
+      if (!os.is_open())
+	std::cerr << "Unable to open profile file: " << out << std::endl;
+      else report(tots, os, scale, clamp);
+    }
+  }
+
+  ~phase_profiler() {
+    std::lock_guard<std::mutex> lock(mtx);
+    if (on) write(totals, out, 1e6, true);
+    if (mem_on) write(mem_totals, mem_out, 1.0, false);
+  }
+};
 
 struct timer {
   double total_time;
@@ -13,11 +115,44 @@ struct timer {
   std::string name;
   struct timezone tzp;
 
-  timer(std::string name = "PBBS time", bool _start = true)
-  : total_time(0.0), on(false), name(name), tzp({0,0}) {
+  // for the phase_profiler
+  struct phase {std::string path; double time; double mem;};
+  bool profiled;
+  timer* parent;
+  double phase_time;
+  long phase_mem;
+  std::vector<phase> pending; // nested phases not yet assigned to a phase
+
+  timer(std::string name = "PBBS time", bool _start = true,
+	bool profile = true)
+  : total_time(0.0), on(false), name(name), tzp({0,0}),
+    profiled(profile && phase_profiler::enabled()), parent(NULL) {
+    if (profiled) {
+#if !defined(CILK)
+      auto& s = stack();
+      if (s.size() > 0) parent = s.back();
+      s.push_back(this);
+#endif
+      phase_time = get_time();
+      phase_mem = phase_profiler::get().current_memory();
+    }
     if (_start) start();
   }
 
+  // copies are not profiled
+  timer(timer const &t)
+  : total_time(t.total_time), last_time(t.last_time), on(t.on),
+    name(t.name), tzp(t.tzp), profiled(false), parent(NULL) {}
+
+  ~timer() {
+    if (!profiled) return;
+    for (auto const &p : pending) add_phase(name + ";" + p.path, p.time, p.mem);
+#if !defined(CILK)
+    auto& s = stack();
+    if (s.size() > 0 && s.back() == this) s.pop_back();
+#endif
+  }
+
   double get_time() {
     timeval now;
     gettimeofday(&now, &tzp);
@@ -27,6 +162,10 @@ struct timer {
   void start () {
     on = 1;
     last_time = get_time();
+    if (profiled) {
+      phase_time = last_time;
+      phase_mem = phase_profiler::get().current_memory();
+    }
   }
 
   double stop () {
@@ -76,10 +215,36 @@ struct timer {
   }
 
   void next(std::string str) {
+    if (profiled) next_phase(str);
     if (on) report(get_next(), str);
   }
+
+private:
+  // the live profiled timers on this thread, innermost last
+  static std::vector<timer*>& stack() {
+    static thread_local std::vector<timer*> s;
+    return s;
+  }
+
+  // passes a phase to the enclosing timer, or to the profiler if none
+  void add_phase(std::string const &path, double t, double m) {
+    if (parent != NULL) parent->pending.push_back(phase{path, t, m});
+    else phase_profiler::get().add(path, t, m);
+  }
+
+  void next_phase(std::string const &str) {
+    double t = get_time();
+    long m = phase_profiler::get().current_memory();
+    std::string path = name + ";" + str;
+    add_phase(path, t - phase_time, m - phase_mem);
+    for (auto const &p : pending)
+      add_phase(path + ";" + p.path, p.time, p.mem);
+    pending.clear();
+    phase_time = t;
+    phase_mem = m;
+  }
 };
 
-static timer _tm;
+static timer _tm("PBBS time", true, false);
 #define startTime() _tm.start();
 #define nextTime(_string) _tm.next(_string);
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "sequence.h"
+#include "nested_sequence.h"
 
 namespace pbbs {
   
@@ -35,6 +36,39 @@ namespace pbbs {
     return r;
   }
 
+  // Same as group_by, but returns the distinct keys and, in a
+  // nested_sequence, the values for each key, which are just the values
+  // of the sorted pairs cut at the key boundaries, so they need no
+  // per-key allocation.
+  template <class Seq, class Comp>
+  auto group_by_nested(Seq &&S, Comp less) {
+    using KV = typename std::remove_reference<Seq>::type::value_type;
+    using K = typename KV::first_type;
+    using V = typename KV::second_type;
+    timer t("group by nested", false);
+    size_t n = S.size();
+
+    auto pair_less = [&] (std::pair<K,V> const &a, std::pair<K,V> const &b) {
+      return less(a.first, b.first);};
+
+    auto sorted = pbbs::sample_sort(std::forward<Seq>(S), pair_less, true);
+    t.next("sort");
+
+    auto Fl = delayed_seq<bool>(n + 1, [&] (size_t i) {
+	return (i==0) || (i==n) || pair_less(sorted[i-1], sorted[i]);});
+    auto idx = pack_index<size_t>(Fl);
+    if (n == 0) idx = sequence<size_t>(1, (size_t) 0);
+    t.next("pack index");
+
+    size_t m = idx.size() - 1;
+    auto keys = tabulate(m, [&] (size_t i) {
+	return std::move(sorted[idx[i]].first);});
+    auto values = tabulate(n, [&] (size_t i) {return sorted[i].second;});
+    t.next("make pairs");
+    return std::make_pair(std::move(keys),
+			  nested_sequence<V>(std::move(values), std::move(idx)));
+  }
+
   template <class T>
   struct compare {
     bool operator()(const T& a, const T& b) const {return a < b;}};
@@ -44,9 +78,22 @@ namespace pbbs {
     bool operator()(char* a, char* b) const {
       return strcmp(a, b) < 0;}};
 
+  template <class Alloc, size_t Inline_Bytes>
+  struct compare<sequence<char,Alloc,Inline_Bytes>> {
+    using S = sequence<char,Alloc,Inline_Bytes>;
+    bool operator()(S const &s1, S const &s2) const {
+      size_t m = std::min(s1.size(), s2.size());
+      size_t i = 0;
+      char* ss1 = s1.begin();
+      char* ss2 = s2.begin();
+      while (i < m && ss1[i] == ss2[i]) i++;
+      return (i < m) ? (ss1[i] < ss2[i]) : (s1.size() < s2.size());
+    }
+  };
+
   template <>
-  struct compare<sequence<char>> {
-    bool operator()(sequence<char> const &s1, sequence<char> const &s2) const {
+  struct compare<range<char*>> {
+    bool operator()(range<char*> const &s1, range<char*> const &s2) const {
       size_t m = std::min(s1.size(), s2.size());
       size_t i = 0;
       char* ss1 = s1.begin();
@@ -63,4 +110,11 @@ namespace pbbs {
     return group_by(std::forward<Seq>(S), compare<K>());
   }
 
+  template <class Seq>
+  auto group_by_nested(Seq &&S) {
+    using KV = typename std::remove_reference<Seq>::type::value_type;
+    using K = typename KV::first_type;
+    return group_by_nested(std::forward<Seq>(S), compare<K>());
+  }
+
 }
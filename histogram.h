@@ -196,8 +196,8 @@ namespace pbbs {
 
     timer t("histogram", false);
     
-    sequence<T> B(n);
-    sequence<T> Tmp(n);
+    sequence<T> B(n, uninitialized);
+    sequence<T> Tmp(n, uninitialized);
 
     // gb is a map (hash) from key to bucket.
     // Keys with many elements (big) have their own bucket while
@@ -214,7 +214,7 @@ namespace pbbs {
     t.next("send to buckets");
 
     // note that this is cache line alligned
-    sequence<s_size_t> counts(m, (s_size_t) 0);
+    sequence<s_size_t> counts(m, zeroed);
     t.next("initialize buckets");
 
     // now in parallel across the buckets, sequentially process each bucket
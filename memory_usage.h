@@ -0,0 +1,65 @@
+#pragma once
+
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include "alloc.h"
+
+// Reports on the memory used by the process.
+// The resident set sizes are read from /proc/self/status, so they are
+// only available on Linux (elsewhere they are returned as zero).
+// The allocator figures are the bytes held by pbbs::default_allocator.
+
+namespace pbbs {
+
+  // returns the given field (e.g. "VmHWM") of /proc/self/status in bytes
+  // or 0 if not available
+  inline size_t proc_status_bytes(std::string const &field) {
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+      if (line.compare(0, field.size() + 1, field + ":") == 0) {
+	std::istringstream ss(line.substr(field.size() + 1));
+	size_t kb = 0;
+	ss >> kb;
+	return kb * 1024;
+      }
+    }
+    return 0;
+  }
+
+  // current resident set size in bytes
+  inline size_t current_rss() { return proc_status_bytes("VmRSS"); }
+
+  // peak resident set size in bytes (since start or last reset)
+  inline size_t peak_rss() { return proc_status_bytes("VmHWM"); }
+
+  // resets the peak resident set size to the current one
+  // returns false if not supported
+  inline bool reset_peak_rss() {
+    std::ofstream clear_refs("/proc/self/clear_refs");
+    if (!clear_refs.is_open()) return false;
+    clear_refs << "5";
+    return clear_refs.good();
+  }
+
+  // resets both the peak resident set size and peak allocator bytes in use
+  inline void reset_peak_memory() {
+    reset_peak_rss();
+    default_allocator.reset_peak();
+  }
+
+  // prints peak resident set size and peak bytes in use from the allocator
+  inline void report_memory(std::string const &name) {
+    std::ios::fmtflags cout_settings = std::cout.flags();
+    std::cout.precision(4);
+    std::cout << std::fixed;
+    std::cout << name << ": peak rss: " << peak_rss()/1e6
+	      << " MB, peak allocated: "
+	      << default_allocator.peak_bytes_in_use()/1e6 << " MB"
+	      << std::endl;
+    std::cout.flags(cout_settings);
+  }
+}
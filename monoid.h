@@ -2,15 +2,76 @@
 #include <limits>
 #include <tuple>
 #include <array>
+#include <algorithm>
+#include <cstddef>
+#include <type_traits>
 
 // Definition of various monoids
 // each consists of:
 //   T : type of the values
 //   static T identity() : returns identity for the monoid
 //   static T add(T, T) : adds two elements, must be associative
+//
+// A monoid can also declare properties that algorithms check at compile
+// time, as static constexpr members:
+//   commutative : f(a,b) == f(b,a), so values can be combined in any
+//     order (e.g. collect_reduce accumulates per worker, not per block,
+//     if the results are also exact, see is_reorderable)
+//   idempotent : f(a,a) == a, so a value can be combined more than
+//     once (e.g. a reduce can use overlapping blocks)
+//   simd : f is the given elementwise operation on an arithmetic type,
+//     so a sequential reduce can keep independent accumulators that the
+//     compiler vectorizes
+// They are read with is_commutative<M>, is_idempotent<M> and
+// simd_op<M>, which are false (or simd_kind::none) if not declared.
 
 namespace pbbs {
 
+  enum class simd_kind {none, add, min, max, bit_xor};
+
+  template <class M, class = void>
+  struct is_commutative : std::false_type {};
+  template <class M>
+  struct is_commutative<M, std::void_t<decltype(M::commutative)>>
+    : std::integral_constant<bool, M::commutative> {};
+
+  template <class M, class = void>
+  struct is_idempotent : std::false_type {};
+  template <class M>
+  struct is_idempotent<M, std::void_t<decltype(M::idempotent)>>
+    : std::integral_constant<bool, M::idempotent> {};
+
+  template <class M, class = void>
+  struct simd_op : std::integral_constant<simd_kind, simd_kind::none> {};
+  template <class M>
+  struct simd_op<M, std::void_t<decltype(M::simd)>>
+    : std::integral_constant<simd_kind, M::simd> {};
+
+  template <class T, simd_kind k>
+  constexpr simd_kind simd_if_arithmetic =
+    std::is_arithmetic<T>::value ? k : simd_kind::none;
+
+  // whether values of type T hold floating point numbers, whose sums
+  // depend on the order they are added in
+  template <class T> struct has_floating_point : std::is_floating_point<T> {};
+  template <class A, class B>
+  struct has_floating_point<std::pair<A,B>>
+    : std::integral_constant<bool, (has_floating_point<A>::value ||
+				    has_floating_point<B>::value)> {};
+  template <class... Ts>
+  struct has_floating_point<std::tuple<Ts...>>
+    : std::integral_constant<bool, (has_floating_point<Ts>::value || ...)> {};
+  template <class A, size_t n>
+  struct has_floating_point<std::array<A,n>> : has_floating_point<A> {};
+
+  // Whether combining values of type T with M in an order that depends
+  // on the schedule gives the same result every time: M is commutative,
+  // and either idempotent (e.g. min and max) or T is not floating point.
+  template <class M, class T>
+  constexpr bool is_reorderable =
+    is_commutative<M>::value &&
+    (is_idempotent<M>::value || !has_floating_point<T>::value);
+
   template <class F, class TT>
   struct monoid {
     using T = TT;
@@ -24,31 +85,52 @@ namespace pbbs {
     return monoid<F,T>(f, id);
   }
 
+  // pairs combined componentwise, with the properties both have
   template <class M1, class M2>
-  auto pair_monoid (M1 m1, M2 m2) {
-    using P = std::pair<typename M1::T, typename M2::T>;
-    auto f = [&] (P a, P b) {
-      return P(m1.f(a.first, b.first), m2.f(a.second, b.second));};
-    return make_monoid(f, P(m1.identity, m2.identity));
-  }
+  struct pairm {
+    using T = std::pair<typename M1::T, typename M2::T>;
+    static constexpr bool commutative =
+      is_commutative<M1>::value && is_commutative<M2>::value;
+    static constexpr bool idempotent =
+      is_idempotent<M1>::value && is_idempotent<M2>::value;
+    M1 m1; M2 m2;
+    T identity;
+    pairm(M1 m1, M2 m2) : m1(m1), m2(m2), identity(m1.identity, m2.identity) {}
+    T f(T a, T b) const {
+      return T(m1.f(a.first, b.first), m2.f(a.second, b.second));}
+  };
+
+  template <class M1, class M2>
+  pairm<M1,M2> pair_monoid (M1 m1, M2 m2) {
+    return pairm<M1,M2>(m1, m2);}
 
+  // arrays of n combined elementwise
   template <class M, size_t n>
-  auto array_monoid (M m) {
-    using Ar = std::array<typename M::T, n>;
-    auto f = [&] (Ar a, Ar b) {
-      Ar r;
+  struct arraym {
+    using T = std::array<typename M::T, n>;
+    static constexpr bool commutative = is_commutative<M>::value;
+    static constexpr bool idempotent = is_idempotent<M>::value;
+    M m;
+    T identity;
+    arraym(M m) : m(m) {
+      for (size_t i=0; i < n; i++) identity[i] = m.identity;}
+    T f(T a, T b) const {
+      T r;
       for (size_t i=0; i < n; i++)
 	r[i] = m.f(a[i], b[i]);
       return r;
-    };
-    Ar id;
-    for (size_t i=0; i < n; i++) id[i] = m.identity;
-    return make_monoid(f, id);
-  }
-  
+    }
+  };
+
+  template <class M, size_t n>
+  arraym<M,n> array_monoid (M m) {
+    return arraym<M,n>(m);}
+
   template <class TT>
   struct addm {
     using T = TT;
+    static constexpr bool commutative = true;
+    static constexpr simd_kind simd = simd_if_arithmetic<T, simd_kind::add>;
     addm() : identity(0) {}
     T identity;
     static T f(T a, T b) {return a + b;}
@@ -63,6 +145,9 @@ namespace pbbs {
   template <class TT>
   struct maxm{
     using T = TT;
+    static constexpr bool commutative = true;
+    static constexpr bool idempotent = true;
+    static constexpr simd_kind simd = simd_if_arithmetic<T, simd_kind::max>;
     maxm() : identity(lowest<T>()) {}
     T identity;
     static T f(T a, T b) {return std::max(a,b);}
@@ -71,6 +156,8 @@ namespace pbbs {
   template <class T1, class T2>
   struct maxm<std::pair<T1,T2>> {
     using T = std::pair<T1,T2>;
+    static constexpr bool commutative = true;
+    static constexpr bool idempotent = true;
     maxm() : identity(std::make_pair(lowest<T1>(), lowest<T2>())) {}
     T identity;
     static T f(T a, T b) {return std::max(a,b);}
@@ -79,6 +166,9 @@ namespace pbbs {
   template <class TT>
   struct minm {
     using T = TT;
+    static constexpr bool commutative = true;
+    static constexpr bool idempotent = true;
+    static constexpr simd_kind simd = simd_if_arithmetic<T, simd_kind::min>;
     minm() : identity(highest<T>()) {}
     T identity;
     static T f(T a, T b) {return std::min(a,b);}
@@ -87,14 +177,19 @@ namespace pbbs {
   template <class T1, class T2>
   struct minm<std::pair<T1,T2>> {
     using T = std::pair<T1,T2>;
+    static constexpr bool commutative = true;
+    static constexpr bool idempotent = true;
     minm() : identity(std::make_pair(highest<T1>(), highest<T2>())) {}
     T identity;
-    static T f(T a, T b) {return std::max(a,b);}
+    static T f(T a, T b) {return std::min(a,b);}
   };
 
   template <class TT>
   struct xorm {
     using T = TT;
+    static constexpr bool commutative = true;
+    static constexpr simd_kind simd =
+      std::is_integral<T>::value ? simd_kind::bit_xor : simd_kind::none;
     xorm() : identity(0) {}
     T identity;
     static T f(T a, T b) {return a ^ b;}
@@ -103,15 +198,74 @@ namespace pbbs {
   template <class TT>
   struct minmaxm {
     using T = std::pair<TT,TT>;
-    minmaxm() : identity(T(highest<T>(), lowest<T>())) {}
+    static constexpr bool commutative = true;
+    static constexpr bool idempotent = true;
+    minmaxm() : identity(T(highest<TT>(), lowest<TT>())) {}
     T identity;
     static T f(T a, T b) {return T(std::min(a.first,b.first),
 				   std::max(a.second,b.second));}
   };
 
+  // Maximum contiguous subsequence sum (MCSS).  A value is (best,
+  // best prefix, best suffix, total) for a subsequence, and single(a)
+  // gives the value for one element.  Only non-empty subsequences
+  // count, so if all elements are negative the best is the largest.
+  // The identity uses lowest<TT>() for "no subsequence", and plus keeps
+  // it from being added to.
+  template <class TT>
+  struct mcssm {
+    using T = std::tuple<TT,TT,TT,TT>;
+    mcssm() : identity(T(lowest<TT>(), lowest<TT>(), lowest<TT>(), 0)) {}
+    T identity;
+    static T single(TT a) {return T(a, a, a, a);}
+    static TT plus(TT a, TT b) {
+      return (a == lowest<TT>() || b == lowest<TT>()) ? lowest<TT>() : a + b;}
+    static T f(T a, T b) {
+      auto [ba, pa, sa, ta] = a;
+      auto [bb, pb, sb, tb] = b;
+      return T(std::max(std::max(ba, bb), plus(sa, pb)),
+	       std::max(pa, plus(ta, pb)),
+	       std::max(plus(sa, tb), sb),
+	       ta + tb);}
+  };
+
+  // Like mcssm, but the best subsequence is also located: it covers
+  // positions [best_lo, best_hi).  single(a, i) gives the value for
+  // element a at position i.
+  template <class TT>
+  struct mcss_intervalm {
+    struct T {
+      TT best, prefix, suffix, total;
+      size_t best_lo, best_hi, prefix_hi, suffix_lo;
+      bool empty;
+    };
+    mcss_intervalm() : identity(T{0, 0, 0, 0, 0, 0, 0, 0, true}) {}
+    T identity;
+    static T single(TT a, size_t i) {
+      return T{a, a, a, a, i, i + 1, i + 1, i, false};}
+    static T f(T a, T b) {
+      if (a.empty) return b;
+      if (b.empty) return a;
+      T r = a;
+      if (b.best > r.best) {
+	r.best = b.best; r.best_lo = b.best_lo; r.best_hi = b.best_hi;}
+      if (a.suffix + b.prefix > r.best) {
+	r.best = a.suffix + b.prefix;
+	r.best_lo = a.suffix_lo; r.best_hi = b.prefix_hi;}
+      if (a.total + b.prefix > r.prefix) {
+	r.prefix = a.total + b.prefix; r.prefix_hi = b.prefix_hi;}
+      r.suffix = b.suffix; r.suffix_lo = b.suffix_lo;
+      if (a.suffix + b.total > r.suffix) {
+	r.suffix = a.suffix + b.total; r.suffix_lo = a.suffix_lo;}
+      r.total = a.total + b.total;
+      return r;
+    }
+  };
+
   template <class TT>
   struct Add {
     using T = TT;
+    static constexpr bool commutative = true;
     static T identity() {return (T) 0;}
     static T add(T a, T b) {return a + b;}
   };
@@ -119,6 +273,8 @@ namespace pbbs {
   template <class TT>
   struct Max {
     using T = TT;
+    static constexpr bool commutative = true;
+    static constexpr bool idempotent = true;
     static T identity() {
       return (T) std::numeric_limits<T>::min();}
     static T add(T a, T b) {return std::max(a,b);}
@@ -127,6 +283,8 @@ namespace pbbs {
   template <class TT>
   struct Min {
     using T = TT;
+    static constexpr bool commutative = true;
+    static constexpr bool idempotent = true;
     static T identity() {
       return (T) std::numeric_limits<T>::max();}
     static T add(T a, T b) {return std::min(a,b);}
@@ -135,6 +293,8 @@ namespace pbbs {
   template <class A1, class A2>
   struct Add_Pair {
     using T = std::pair<typename A1::T, typename A2::T>;
+    static constexpr bool commutative =
+      is_commutative<A1>::value && is_commutative<A2>::value;
     static T identity() {return T(A1::identity(), A2::identity());}
     static T add(T a, T b) {
       return T(A1::add(a.first,b.first), A2::add(a.second,b.second));}
@@ -144,6 +304,7 @@ namespace pbbs {
   struct Add_Array {
     using S = std::tuple_size<AT>;
     using T = std::array<typename AT::value_type, S::value>;
+    static constexpr bool commutative = true;
     static T identity() {
       T r;
       for (size_t i=0; i < S::value; i++)
@@ -163,6 +324,7 @@ namespace pbbs {
     using T = AT;
     using S = std::tuple_size<T>;
     using SS = std::tuple_size<typename AT::value_type>;
+    static constexpr bool commutative = true;
     static T identity() {
       T r;
       for (size_t i=0; i < S::value; i++)
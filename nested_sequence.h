@@ -0,0 +1,127 @@
+// This code is part of the Problem Based Benchmark Suite (PBBS)
+// Copyright (c) 2011-2019 Guy Blelloch and the PBBS team
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights (to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+// LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// A sequence of sequences (a ragged array) stored flat: all the
+// values are contiguous, and an array of n+1 offsets gives where each
+// inner sequence starts.  Compared to sequence<sequence<T>> it takes
+// two allocations instead of one per inner sequence, and flattening it
+// is free.  Element i is a range into the values, so it can be
+// modified in place but not resized.
+
+#pragma once
+
+#include "sequence.h"
+
+namespace pbbs {
+
+  template <class T>
+  struct nested_sequence {
+  public:
+    using value_type = range<T*>;
+
+    nested_sequence() : offs(1, (size_t) 0) {}
+
+    // Inner sequence i has size_f(i) elements, with element j given by
+    // f(i, j).  The sizes are scanned for the offsets, then the
+    // elements are filled in parallel.
+    template <class Size_F, class F>
+    nested_sequence(size_t n, Size_F size_f, F f) {
+      init_offsets(n, size_f);
+      vals = sequence<T>::no_init(offs[n]);
+      parallel_for(0, n, [&] (size_t i) {
+	  size_t s = offs[i];
+	  parallel_for(0, offs[i+1] - s, [&] (size_t j) {
+	      assign_uninitialized(vals[s + j], (T) f(i, j));}, 1000);});
+    }
+
+    // Copies any sequence of sequences, e.g. a sequence<sequence<T>>.
+    template <class Seq_Seq>
+    static nested_sequence from_nested(Seq_Seq const &S) {
+      return nested_sequence(S.size(), [&] (size_t i) {return S[i].size();},
+			     [&] (size_t i, size_t j) {return S[i][j];});
+    }
+
+    // Same as above but leaves the values uninitialized, to be filled
+    // through operator[].
+    template <class Size_F>
+    static nested_sequence no_init(size_t n, Size_F size_f) {
+      nested_sequence r;
+      r.init_offsets(n, size_f);
+      r.vals = sequence<T>::no_init(r.offs[n]);
+      return r;
+    }
+
+    // Takes the values and the n+1 offsets (starting at 0 and ending at
+    // values.size()) without copying.
+    nested_sequence(sequence<T> &&values, sequence<size_t> &&offsets)
+      : vals(std::move(values)), offs(std::move(offsets)) {
+      if (offs.size() == 0 || offs[0] != 0 || offs[offs.size()-1] != vals.size())
+	throw std::invalid_argument("nested_sequence: offsets do not match values");
+    }
+
+    // number of inner sequences
+    size_t size() const {return offs.size() - 1;}
+
+    range<T*> operator[] (size_t i) const {
+      return vals.slice(offs[i], offs[i+1]);}
+
+    size_t inner_size(size_t i) const {return offs[i+1] - offs[i];}
+
+    // total number of values
+    size_t num_values() const {return vals.size();}
+
+    auto slice(size_t ss, size_t ee) const {
+      return delayed_seq<range<T*>>(ee - ss, [this, ss] (size_t i) {
+	  return (*this)[ss + i];});}
+    auto slice() const {return slice(0, size());}
+
+    // All the values, as a range (the flattened sequence).
+    range<T*> values() const {return vals.slice();}
+    sequence<size_t> const &offsets() const {return offs;}
+
+    // Gives up the values, leaving this empty.
+    sequence<T> release_values() {
+      offs = sequence<size_t>(1, (size_t) 0);
+      return std::move(vals);}
+
+  private:
+    sequence<T> vals;
+    sequence<size_t> offs;
+
+    template <class Size_F>
+    void init_offsets(size_t n, Size_F size_f) {
+      offs = sequence<size_t>::no_init(n + 1);
+      parallel_for(0, n, [&] (size_t i) {offs[i] = size_f(i);});
+      offs[n] = scan_inplace(offs.slice(0, n), addm<size_t>());
+    }
+  };
+
+  // Flattening a nested sequence is a copy of its values, or nothing if
+  // it is an rvalue.
+  template <class T>
+  sequence<T> flatten(nested_sequence<T> const &S) {
+    return sequence<T>(S.values());}
+
+  template <class T>
+  sequence<T> flatten(nested_sequence<T> &&S) {
+    return S.release_values();}
+}
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <algorithm>
+
 //***************************************
 // All the pbbs library uses only four functions for
 // accessing parallelism.
@@ -33,6 +35,15 @@ static void parallel_for(long start, long end, F f,
 template <typename Lf, typename Rf>
 static void par_do(Lf left, Rf right, bool conservative=false);
 
+// parallel loop that can be cut short: stop(i) returning true means
+// the iterations from i on are no longer needed.  It is checked at
+// chunk boundaries (chunks of granularity iterations), so f can set
+// whatever stop reads to cancel the rest of the loop.
+template <typename F, typename S>
+static void parallel_for_until(long start, long end, F f, S stop,
+			       long granularity,
+			       bool conservative = false);
+
 //***************************************
 
 // cilkplus
@@ -165,6 +176,14 @@ inline void par_do(Lf left, Rf right, bool conservative) {
   return fj.pardo(left, right, conservative);
 }
 
+template <typename F, typename S>
+inline void parallel_for_until(long start, long end, F f, S stop,
+			       long granularity,
+			       bool conservative) {
+  if (end > start)
+    fj.parfor_until(start, end, f, stop, granularity, conservative);
+}
+
 template <typename Job>
 inline void parallel_run(Job job, int num_threads=0) {
   job();
@@ -198,3 +217,21 @@ inline void parallel_run(Job job, int num_threads=0) {
 }
 
 #endif
+
+// the other schedulers get it from par_do
+#if !defined(HOMEGROWN)
+template <typename F, typename S>
+inline void parallel_for_until(long start, long end, F f, S stop,
+			       long granularity,
+			       bool conservative) {
+  if (end <= start || stop(start)) return;
+  if (end - start <= std::max<long>(granularity, 1))
+    for (long i=start; i < end; i++) f(i);
+  else {
+    long mid = start + (9*(end-start+1))/16;
+    par_do([&] () {parallel_for_until(start, mid, f, stop, granularity, conservative);},
+	   [&] () {parallel_for_until(mid, end, f, stop, granularity, conservative);},
+	   conservative);
+  }
+}
+#endif
@@ -0,0 +1,150 @@
+// This code is part of the Problem Based Benchmark Suite (PBBS)
+// Copyright (c) 2011-2019 Guy Blelloch and the PBBS team
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights (to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+// LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// Segmented sieve of Eratosthenes.
+//
+// Only odd numbers are represented, one bit each (bit i is 2i+1).  The
+// range is cut into segments that fit in L2 cache, and the segments
+// are sieved in parallel, each by all the primes up to sqrt(n), so
+// each segment is brought into cache once instead of once per prime.
+// The multiples of 3, 5, 7, 11 and 13 are not sieved but copied from a
+// precomputed pattern (a wheel), which repeats every 15015 words.
+// Work is O(n log log n), Span is O(sqrt(n) / segment size + log n).
+
+#pragma once
+
+#include <cmath>
+#include <iterator>
+#include "sequence.h"
+
+namespace pbbs {
+
+  // The primes up to and including n, in increasing order.
+  template <class Int>
+  sequence<Int> prime_sieve(Int n);
+
+  // The number of primes up to and including n, without storing them.
+  template <class Int>
+  size_t prime_count(Int n);
+
+  namespace sieve {
+    // odd numbers per segment (128 Kbytes of bits)
+    constexpr size_t segment_bits = ((size_t) 1) << 20;
+    constexpr size_t segment_words = segment_bits / 64;
+    constexpr size_t wheel_primes[] = {3, 5, 7, 11, 13};
+    constexpr size_t wheel_words = 3 * 5 * 7 * 11 * 13;
+
+    // words of bits for the odd numbers up to n
+    inline size_t num_words(size_t n) {return ((n + 1) / 2 + 63) / 64;}
+
+    // bit i of word j is set if 64j+i is not a multiple of a wheel prime
+    // as an index, i.e. 2(64j+i)+1 is not a multiple of it
+    inline sequence<uint64_t> const &wheel() {
+      static sequence<uint64_t> w(wheel_words, [] (size_t j) {
+	  uint64_t m = 0;
+	  for (size_t i = 0; i < 64; i++) {
+	    size_t v = 2 * (64 * j + i) + 1;
+	    bool keep = true;
+	    for (size_t p : wheel_primes) keep = keep && (v % p != 0);
+	    m |= ((uint64_t) keep) << i;
+	  }
+	  return m;});
+      return w;
+    }
+
+    // Calls f(j, w) for each word j of the sieve of the odd numbers up
+    // to n, after the word has been computed.  Bit i of word j is set
+    // if 2(64j+i)+1 is prime, except that bit 0 is set for 2 instead of
+    // 1 (if n >= 2).  Bits past n are 0.
+    template <class Int, class F>
+    void sieve_words(Int n, F f) {
+      size_t bits = ((size_t) n + 1) / 2;
+      size_t nw = num_words(n);
+      size_t ns = (nw + segment_words - 1) / segment_words;
+      auto base = prime_sieve<Int>((Int) std::sqrt((double) n) + 1);
+      auto const &wh = wheel();
+      parallel_for(0, ns, [&] (size_t s) {
+	  size_t w0 = s * segment_words;
+	  size_t w1 = std::min(nw, w0 + segment_words);
+	  sequence<uint64_t> seg = sequence<uint64_t>::no_init(w1 - w0);
+	  size_t k = w0 % wheel_words;
+	  for (size_t j = 0; j < w1 - w0; j++) {
+	    seg[j] = wh[k];
+	    if (++k == wheel_words) k = 0;
+	  }
+	  size_t lo = 2 * (64 * w0) + 1;        // first odd number
+	  size_t hi = 2 * (64 * w1) + 1;        // past the last
+	  // sieve by the primes after 2 and the wheel primes
+	  for (size_t i = 1 + std::size(wheel_primes); i < base.size(); i++) {
+	    size_t p = base[i];
+	    if (p * p >= hi) break;
+	    size_t m = std::max(p * p, (lo + p - 1) / p * p);
+	    if (m % 2 == 0) m += p;
+	    for (size_t b = (m - lo) / 2; b < 64 * (w1 - w0); b += p)
+	      seg[b / 64] &= ~(((uint64_t) 1) << (b % 64));
+	  }
+	  if (s == 0) {
+	    // 1 is not prime (its bit stands for 2), the wheel primes are
+	    seg[0] &= ~((uint64_t) 1);
+	    if (n >= 2) seg[0] |= 1;
+	    for (size_t p : wheel_primes)
+	      if (p <= (size_t) n) seg[0] |= ((uint64_t) 1) << (p / 2);
+	  }
+	  if (w1 == nw && bits % 64 != 0)
+	    seg[w1 - w0 - 1] &= (((uint64_t) 1) << (bits % 64)) - 1;
+	  for (size_t j = w0; j < w1; j++) f(j, seg[j - w0]);
+	}, 1);
+    }
+  }
+
+  template <class Int>
+  sequence<Int> prime_sieve(Int n) {
+    if (n < 2) return sequence<Int>();
+    if (n < 64) {
+      // small enough to just test
+      auto is_prime = [] (Int v) {
+	for (Int d = 2; d * d <= v; d++) if (v % d == 0) return false;
+	return true;};
+      auto flags = delayed_seq<bool>(n + 1, [&] (size_t i) {
+	  return i >= 2 && is_prime(i);});
+      return pack_index<Int>(flags);
+    }
+    size_t nw = sieve::num_words(n);
+    sequence<uint64_t> words = sequence<uint64_t>::no_init(nw);
+    sieve::sieve_words(n, [&] (size_t j, uint64_t w) {words[j] = w;});
+    auto r = pack_index_bits<Int>(64 * nw, [&] (size_t j) {return words[j];});
+    parallel_for(0, r.size(), [&] (size_t i) {
+	r[i] = (r[i] == 0) ? 2 : 2 * r[i] + 1;});
+    return r;
+  }
+
+  template <class Int>
+  size_t prime_count(Int n) {
+    if (n < 64) return prime_sieve(n).size();
+    size_t nw = sieve::num_words(n);
+    size_t ns = (nw + sieve::segment_words - 1) / sieve::segment_words;
+    sequence<size_t> counts(ns, zeroed);
+    sieve::sieve_words(n, [&] (size_t j, uint64_t w) {
+	counts[j / sieve::segment_words] += __builtin_popcountll(w);});
+    return reduce(counts, addm<size_t>());
+  }
+}
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <atomic>
 #include <chrono>
 #include <thread>
 #include <cstdint>
@@ -356,6 +357,27 @@ public:
     } else parfor_(start, end, f, granularity, conservative);
   }
 
+  // Same as parfor but skips the rest of the loop once it is no longer
+  // needed: stop(i) returning true means no iteration from i on needs to
+  // run (e.g. once a search has found a hit before i).  It is checked
+  // before each split and each chunk of granularity iterations, so once
+  // it holds the loop winds down after the chunks already running.
+  template <typename F, typename S>
+  void parfor_until(size_t start, size_t end, F f, S stop,
+		    size_t granularity,
+		    bool conservative = false) {
+    if (end <= start || stop(start)) return;
+    if ((end - start) <= std::max<size_t>(granularity, 1))
+      for (size_t i=start; i < end; i++) f(i);
+    else {
+      size_t n = end-start;
+      size_t mid = (start + (9*(n+1))/16);
+      pardo([&] () {parfor_until(start, mid, f, stop, granularity, conservative);},
+	    [&] () {parfor_until(mid, end, f, stop, granularity, conservative);},
+	    conservative);
+    }
+  }
+
 private:
 
   template <typename F>
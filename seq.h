@@ -5,7 +5,33 @@
 #include <initializer_list>
 #include <iterator>
 
-#ifdef CONCEPTS
+// Seq: has a value_type, size(), slice() and operator[] (e.g. a
+// sequence, range or delayed_sequence).  Range: a Seq whose elements
+// can be written through operator[], with an iterator.  With
+// -DCONCEPTS the templates using SEQ and RANGE are constrained by
+// them, as C++20 concepts if the compiler has them (-std=c++20) and
+// otherwise in the concepts TS syntax (-fconcepts).
+#if defined(CONCEPTS) && defined(__cpp_concepts) && __cpp_concepts >= 201907L
+#include <concepts>
+
+template<typename T>
+concept Seq =
+  requires(T t, size_t u) {
+  typename T::value_type;
+  { t.size() } -> std::convertible_to<size_t>;
+  t.slice();
+  t[u];
+};
+
+template<typename T>
+concept Range =
+  Seq<T> && requires(T t, size_t u) {
+  { t[u] } -> std::same_as<typename T::value_type&>;
+  typename T::iterator;
+};
+#define SEQ Seq
+#define RANGE Range
+#elif defined(CONCEPTS)
 template<typename T>
 concept bool Seq =
   requires(T t, size_t u) {
@@ -69,6 +95,46 @@ namespace pbbs {
   template <typename T, typename F>
   struct delayed_sequence {
     using value_type = T;
+
+    // Random access, returning the values themselves, so a delayed
+    // sequence works with the standard algorithms and (in C++20)
+    // models std::ranges::random_access_range.  Since reference is not
+    // a reference, the C++17 category is only input (as for
+    // std::ranges::iota_view).  It refers to the delayed sequence,
+    // which must outlive it.
+    struct iterator {
+      using iterator_concept = std::random_access_iterator_tag;
+      using iterator_category = std::input_iterator_tag;
+      using value_type = T;
+      using difference_type = std::ptrdiff_t;
+      using pointer = void;
+      using reference = T;
+
+      iterator() : d(nullptr), i(0) {}
+      iterator(const delayed_sequence* d, difference_type i) : d(d), i(i) {}
+      T operator* () const {return (*d)[i];}
+      T operator[] (difference_type k) const {return (*d)[i + k];}
+      iterator& operator++ () {++i; return *this;}
+      iterator operator++ (int) {iterator r = *this; ++i; return r;}
+      iterator& operator-- () {--i; return *this;}
+      iterator operator-- (int) {iterator r = *this; --i; return r;}
+      iterator& operator+= (difference_type k) {i += k; return *this;}
+      iterator& operator-= (difference_type k) {i -= k; return *this;}
+      iterator operator+ (difference_type k) const {return iterator(d, i + k);}
+      iterator operator- (difference_type k) const {return iterator(d, i - k);}
+      friend iterator operator+ (difference_type k, iterator a) {return a + k;}
+      difference_type operator- (iterator a) const {return i - a.i;}
+      bool operator== (iterator a) const {return i == a.i;}
+      bool operator!= (iterator a) const {return i != a.i;}
+      bool operator< (iterator a) const {return i < a.i;}
+      bool operator> (iterator a) const {return i > a.i;}
+      bool operator<= (iterator a) const {return i <= a.i;}
+      bool operator>= (iterator a) const {return i >= a.i;}
+    private:
+      const delayed_sequence* d;
+      difference_type i;
+    };
+
     delayed_sequence(size_t n, F _f) : f(_f), s(0), e(n) {};
     delayed_sequence(size_t n, value_type v) : f([&] (size_t i) {return v;}), s(0), e(n) {};
     delayed_sequence(size_t s, size_t e, F _f) : f(_f), s(s), e(e) {};
@@ -78,6 +144,8 @@ namespace pbbs {
     delayed_sequence<T,F> slice() const {
       return delayed_sequence<T,F>(s,e,f); }
     size_t size() const { return e - s;}
+    iterator begin() const {return iterator(this, 0);}
+    iterator end() const {return iterator(this, size());}
   private:
     F f;
     const size_t s, e;
@@ -96,7 +164,18 @@ namespace pbbs {
     return delayed_sequence<T,F>(n,f);
   }
 
-  template <typename T, typename Allocator=pbbs::allocator<T>>
+  // Tags for the sequence(n, tag) constructors.
+  struct uninitialized_t {};
+  struct zeroed_t {};
+  struct parallel_fill_t {};
+  constexpr uninitialized_t uninitialized{};
+  constexpr zeroed_t zeroed{};
+  constexpr parallel_fill_t parallel_fill{};
+
+  // Inline_Bytes is the size of the inline buffer used by the short
+  // string optimization (SSO), at least 16 (see below).
+  template <typename T, typename Allocator=pbbs::allocator<T>,
+	    size_t Inline_Bytes=16>
   struct sequence {
   public:
     using value_type = T;
@@ -144,16 +223,34 @@ namespace pbbs {
       // cout << "dangerous: " << size();
     };
 
-    static sequence<T> no_init(const size_t sz) {
-      sequence<T> r;
+    static sequence no_init(const size_t sz) {
+      sequence r;
       r.alloc_no_init(sz);
       return r;
     };
 
-    sequence(const size_t sz, value_type v) {
+    // sequence(sz) default initializes, which for trivial types means
+    // no initialization.  The tagged versions say what is wanted:
+    //   uninitialized : nothing, even for non-trivial types (same as no_init)
+    //   zeroed : all bytes 0, only for trivially copyable types
+    //   parallel_fill : every element value initialized, i.e. T()
+    sequence(const size_t sz, uninitialized_t) {
+      alloc_no_init(sz);}
+
+    sequence(const size_t sz, zeroed_t) {
+      zero_uninitialized(alloc_no_init(sz), sz);}
+
+    sequence(const size_t sz, parallel_fill_t) {
       T* start = alloc_no_init(sz);
-      parallel_for(0, sz, [=] (size_t i) {
-	  assign_uninitialized(start[i], (T) v);}, 300);
+      if constexpr (std::is_trivially_default_constructible<T>::value &&
+		    std::is_trivially_copyable<T>::value)
+	zero_uninitialized(start, sz);
+      else parallel_for(0, sz, [&] (size_t i) {
+	  new ((void*) (start+i)) T();}, 1000);
+    }
+
+    sequence(const size_t sz, value_type v) {
+      fill_uninitialized(alloc_no_init(sz), sz, v);
     };
 
     template <typename Func>
@@ -236,12 +333,10 @@ namespace pbbs {
       return begin()[i];
     }
 
-    void swap(sequence& b) {
-      std::swap(val.large.s, b.val.large.s); std::swap(val.large.n, b.val.large.n);
-    }
+    void swap(sequence& b) {std::swap(val, b.val);}
 
     size_t size() const {
-      if (is_small()) return val.small[15];
+      if (is_small()) return (unsigned char) val.small[sso_tag];
       return val.large.n;}
 
     value_type* begin() const {
@@ -256,18 +351,26 @@ namespace pbbs {
     static constexpr size_t lg_size = sizeof(lg);
     static constexpr size_t T_size = sizeof(T);
     static constexpr size_t max_sso_size = 8;
+    static constexpr size_t inline_bytes = std::max(lg_size, Inline_Bytes);
+    static_assert(inline_bytes <= 256, "sequence: inline buffer too large");
 
     // Uses short string optimization (SSO).
-    // Applied if T_size <= max_sso_size
+    // Applied if T_size <= max_sso_size.  The elements are stored in
+    // place of the pointer and size, and the size in the last byte
+    // (sso_tag), which is 0 for a large sequence.
+    static constexpr size_t sso_tag = inline_bytes - 1;
+    static constexpr size_t sso_capacity =
+      (T_size <= max_sso_size) ? sso_tag / T_size : 0;
     union {
       lg large;
-      char small[lg_size]; // for SSO
+      char small[inline_bytes]; // for SSO
     } val;
 
     // sets start and size
     void set(T* start, size_t sz) {
       val.large.n = sz;
       val.large.s = start;
+      if (inline_bytes > lg_size) val.small[sso_tag] = 0;
     }
       
     // marks as empty
@@ -275,16 +378,13 @@ namespace pbbs {
 
     // is a given size small
     inline bool is_small(size_t sz) const {
-      return ((T_size <= max_sso_size) &&
-	      sz < (lg_size/T_size) &&
-	      sz > 0); }
+      return (sz <= sso_capacity && sz > 0); }
 
     // am I small
     inline bool is_small() const {
-      //return is_small(val.small[15]);
-      if (T_size <= max_sso_size) {
-      	size_t sz = val.small[15];
-      	return (sz > 0 && sz < (lg_size/T_size));
+      if (sso_capacity > 0) {
+	size_t sz = (unsigned char) val.small[sso_tag];
+	return (sz > 0 && sz <= sso_capacity);
       }
       return false;
     }
@@ -304,7 +404,7 @@ namespace pbbs {
     // allocate and set size without initialization
     value_type* alloc_no_init(size_t sz) {
       if (is_small(sz)) {
-	val.small[15] = sz;
+	val.small[sso_tag] = sz;
 	return (T*) &val.small;
       } else {
 	//T* loc = (sz == 0) ? NULL : pbbs::new_array_no_init<T>(sz);
@@ -330,6 +430,10 @@ namespace pbbs {
 
   };
 
+  // Holds up to 31 characters without allocating, which covers most
+  // words, in 32 bytes instead of 16.
+  using short_string = sequence<char, pbbs::allocator<char>, 32>;
+
   template <class Iter>
   bool slice_eq(range<Iter> a, range<Iter> b) {
     return a.begin() == b.begin();}
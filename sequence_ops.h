@@ -73,11 +73,39 @@ namespace pbbs {
     parallel_for(0, l, body, 1, 0 != (fl & fl_conservative));
   }
 
+  // Number of independent accumulators reduce_serial uses for a simd
+  // monoid (see monoid.h).
+  constexpr size_t _reduce_lanes = 8;
+
   template <SEQ Seq, class Monoid>
   auto reduce_serial(Seq const &A, Monoid m) -> typename Seq::value_type {
     using T = typename Seq::value_type;
+    size_t n = A.size();
+    constexpr size_t L = _reduce_lanes;
+    if constexpr (simd_op<Monoid>::value != simd_kind::none &&
+		  std::is_same<T, typename Monoid::T>::value) {
+      if (n >= 2 * L) {
+	// L interleaved partial results, so the loop vectorizes.  If the
+	// monoid is idempotent the last L elements are added as a whole
+	// vector, overlapping elements already added.
+	T acc[L];
+	for (size_t k = 0; k < L; k++) acc[k] = A[k];
+	size_t j = L;
+	for (; j + L <= n; j += L)
+	  for (size_t k = 0; k < L; k++) acc[k] = m.f(acc[k], A[j+k]);
+	if (j < n) {
+	  if constexpr (is_idempotent<Monoid>::value)
+	    for (size_t k = 0; k < L; k++) acc[k] = m.f(acc[k], A[n-L+k]);
+	  else
+	    for (size_t k = 0; j + k < n; k++) acc[k] = m.f(acc[k], A[j+k]);
+	}
+	T r = acc[0];
+	for (size_t k = 1; k < L; k++) r = m.f(r, acc[k]);
+	return r;
+      }
+    }
     T r = A[0];
-    for (size_t j=1; j < A.size(); j++) r = m.f(r,A[j]);
+    for (size_t j=1; j < n; j++) r = m.f(r,A[j]);
     return r;
   }
 
@@ -92,10 +120,10 @@ namespace pbbs {
     if (l == 0) return m.identity;
     if (l == 1 || (fl & fl_sequential)) {
       return reduce_serial(A, m); }
-    sequence<T> Sums(l);
+    sequence<T> Sums(l, uninitialized);
     sliced_for (n, block_size,
 		[&] (size_t i, size_t s, size_t e)
-		{ Sums[i] = reduce_serial(A.slice(s,e), m);});
+		{ assign_uninitialized(Sums[i], reduce_serial(A.slice(s,e), m));});
     T r = reduce(Sums, m);
     return r;
   }
@@ -135,10 +163,10 @@ namespace pbbs {
     size_t l = num_blocks(n,_block_size);
     if (l <= 2 || fl & fl_sequential)
       return scan_serial(In, Out, m, m.identity, fl);
-    sequence<T> Sums(l);
+    sequence<T> Sums(l, uninitialized);
     sliced_for (n, _block_size,
 		[&] (size_t i, size_t s, size_t e)
-		{ Sums[i] = reduce_serial(In.slice(s,e), m);});
+		{ assign_uninitialized(Sums[i], reduce_serial(In.slice(s,e), m));});
     T total = scan_serial(Sums, Sums.slice(), m, m.identity, 0);
     sliced_for (n, _block_size,
 		[&] (size_t i, size_t s, size_t e)
@@ -170,6 +198,95 @@ namespace pbbs {
     return std::make_pair(std::move(Out), total);
   }
 
+  // Segmented scans: a segment starts at each i where Fl[i] is true
+  // (and at 0), and the scan starts over from the identity at each
+  // segment.  Like scan, exclusive unless fl_scan_inclusive is given,
+  // and returns the total of the last segment.  Each block is reduced
+  // to (its last partial segment, whether it has a start), which is
+  // itself scanned before the second pass over the blocks.
+  template <SEQ In_Seq, RANGE Out_Range, SEQ Bool_Seq, class Monoid>
+  auto segmented_scan_(In_Seq const &In, Out_Range Out, Bool_Seq const &Fl,
+		       Monoid const &m, flags fl = no_flag)
+    -> typename In_Seq::value_type
+  {
+    using T = typename In_Seq::value_type;
+    size_t n = In.size();
+    bool inclusive = fl & fl_scan_inclusive;
+    auto scan_block = [&] (size_t s, size_t e, T r) {
+      for (size_t j = s; j < e; j++) {
+	if (Fl[j]) r = m.identity;
+	T t = In[j];
+	if (inclusive) Out[j] = r = m.f(r, t);
+	else {Out[j] = r; r = m.f(r, t);}
+      }
+      return r;
+    };
+    size_t l = num_blocks(n, _block_size);
+    if (l <= 2 || fl & fl_sequential)
+      return scan_block(0, n, m.identity);
+    sequence<T> Sums(l, uninitialized);
+    sequence<bool> Starts(l);
+    sliced_for (n, _block_size, [&] (size_t i, size_t s, size_t e) {
+	T r = m.identity;
+	bool start = false;
+	for (size_t j = s; j < e; j++) {
+	  if (Fl[j]) {r = m.identity; start = true;}
+	  r = m.f(r, In[j]);
+	}
+	assign_uninitialized(Sums[i], r);
+	Starts[i] = start;});
+    T r = m.identity;
+    for (size_t i = 0; i < l; i++) {
+      T t = Sums[i];
+      Sums[i] = r;
+      r = Starts[i] ? t : m.f(r, t);
+    }
+    sliced_for (n, _block_size, [&] (size_t i, size_t s, size_t e) {
+	scan_block(s, e, Sums[i]);});
+    return r;
+  }
+
+  template <RANGE Range, SEQ Bool_Seq, class Monoid>
+  auto segmented_scan_inplace(Range In, Bool_Seq const &Fl, Monoid m,
+			      flags fl = no_flag)
+    -> typename Range::value_type
+  { return segmented_scan_(In, In, Fl, m, fl); }
+
+  template <SEQ In_Seq, SEQ Bool_Seq, class Monoid>
+  auto segmented_scan(In_Seq const &In, Bool_Seq const &Fl, Monoid m,
+		      flags fl = no_flag)
+    ->  std::pair<sequence<typename In_Seq::value_type>, typename In_Seq::value_type>
+  {
+    using T = typename In_Seq::value_type;
+    sequence<T> Out = sequence<T>::no_init(In.size());
+    T total = segmented_scan_(In, Out.slice(), Fl, m, fl);
+    return std::make_pair(std::move(Out), total);
+  }
+
+  // Reduces each segment, where segment i is [Offsets[i], Offsets[i+1])
+  // and the last ends at the end of In.  The offsets must be increasing
+  // (pack_index on segment start flags gives them).  Large segments are
+  // reduced in parallel, and small ones are grouped.
+  template <SEQ In_Seq, SEQ Offset_Seq, class Monoid>
+  auto segmented_reduce(In_Seq const &In, Offset_Seq const &Offsets,
+			Monoid m, flags fl = no_flag)
+    -> sequence<typename In_Seq::value_type>
+  {
+    using T = typename In_Seq::value_type;
+    size_t n = In.size();
+    size_t k = Offsets.size();
+    size_t granularity = (n == 0) ? 1000 :
+      std::min<size_t>(1000, 1 + (k * _block_size) / n);
+    return sequence<T>(k, [&] (size_t i) {
+	size_t s = Offsets[i];
+	size_t e = (i + 1 < k) ? (size_t) Offsets[i+1] : n;
+	if (e - s > _block_size && !(fl & fl_sequential))
+	  return reduce(In.slice(s, e), m);
+	T r = m.identity;
+	for (size_t j = s; j < e; j++) r = m.f(r, In[j]);
+	return r;}, granularity);
+  }
+
   template <SEQ Seq>
   size_t sum_bools_serial(Seq const &I) {
     size_t r = 0;
@@ -293,6 +410,41 @@ namespace pbbs {
     return pack(delayed_seq<Idx_Type>(Fl.size(),identity), Fl, fl);
   }
 
+  // Like pack_index, but the flags are given 64 at a time as bits of a
+  // word: mask(i) returns the flags for positions [64i, 64i+64), with
+  // bit j for position 64i+j.  Bits for positions n or larger must be 0.
+  // Avoids materializing a bool per position (e.g. when the masks come
+  // from SIMD compares).  mask is called twice per word.
+  template <class Idx_Type, class Mask_F>
+  sequence<Idx_Type> pack_index_bits(size_t n, Mask_F const &mask,
+				     flags fl = no_flag) {
+    size_t nw = (n + 63) / 64;
+    size_t l = num_blocks(nw, _block_size);
+    sequence<size_t> Sums(l);
+    sliced_for (nw, _block_size,
+		[&] (size_t i, size_t s, size_t e) {
+		  size_t r = 0;
+		  for (size_t j=s; j < e; j++)
+		    r += __builtin_popcountll(mask(j));
+		  Sums[i] = r;
+		}, fl);
+    size_t m = scan_inplace(Sums.slice(), addm<size_t>());
+    sequence<Idx_Type> Out = sequence<Idx_Type>::no_init(m);
+    sliced_for (nw, _block_size,
+		[&] (size_t i, size_t s, size_t e) {
+		  size_t k = Sums[i];
+		  for (size_t j=s; j < e; j++) {
+		    uint64_t b = mask(j);
+		    while (b) {
+		      assign_uninitialized(Out[k++],
+					   (Idx_Type) (64*j + __builtin_ctzll(b)));
+		      b &= b - 1;
+		    }
+		  }
+		}, fl);
+    return Out;
+  }
+
   template <SEQ In_Seq, SEQ Char_Seq>
   std::pair<size_t,size_t> split_three(In_Seq const &In,
 				       range<typename In_Seq::value_type*> Out,
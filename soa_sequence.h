@@ -0,0 +1,195 @@
+// This code is part of the Problem Based Benchmark Suite (PBBS)
+// Copyright (c) 2011-2019 Guy Blelloch and the PBBS team
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights (to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+// LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// A sequence of tuples stored as a struct of arrays: column I is a
+// sequence<Ts[I]>.  A pass that only needs some of the fields (e.g. the
+// keys) only reads those columns.  Element i is returned by value as a
+// std::tuple, so an soa_sequence (or a slice of it) can be passed to
+// anything taking a read-only Seq, and zip<I,J...>() gives a Seq over
+// just some of the columns.
+//
+// Sorting by a column only moves the keys and a permutation; the other
+// columns are then gathered in a single pass (see permute).
+
+#pragma once
+
+#include <tuple>
+#include <utility>
+#include "sequence.h"
+#include "integer_sort.h"
+#include "sample_sort.h"
+
+namespace pbbs {
+
+  template <class... Ts>
+  struct soa_sequence {
+  public:
+    using value_type = std::tuple<Ts...>;
+    static constexpr size_t num_columns = sizeof...(Ts);
+    template <size_t I>
+    using column_type = typename std::tuple_element<I, value_type>::type;
+
+    soa_sequence() : n(0) {}
+
+    // element i is f(i), which can be anything std::get works on (e.g.
+    // a tuple or pair)
+    template <class F>
+    soa_sequence(size_t n, F f) : soa_sequence(no_init(n)) {
+      parallel_for(0, n, [&] (size_t i) {
+	  init_element(i, f(i), std::index_sequence_for<Ts...>());});
+    }
+
+    // Takes the columns without copying.  They must all have the same size.
+    soa_sequence(sequence<Ts> &&... columns)
+      : n(first_size(columns...)), cols(std::move(columns)...) {
+      if (!same_sizes(std::index_sequence_for<Ts...>()))
+	throw std::invalid_argument("soa_sequence: columns of different sizes");
+    }
+
+    static soa_sequence no_init(size_t n) {
+      return soa_sequence(sequence<Ts>::no_init(n)...);}
+
+    // copies a sequence of tuples or pairs
+    template <class Seq>
+    static soa_sequence from_aos(Seq const &S) {
+      return soa_sequence(S.size(), [&] (size_t i) {return S[i];});}
+
+    size_t size() const {return n;}
+
+    value_type operator[] (size_t i) const {
+      return get_element(i, std::index_sequence_for<Ts...>());}
+
+    void set(size_t i, value_type const &v) {
+      assign(i, v, std::index_sequence_for<Ts...>());}
+
+    template <size_t I>
+    sequence<column_type<I>> &column() {return std::get<I>(cols);}
+    template <size_t I>
+    sequence<column_type<I>> const &column() const {return std::get<I>(cols);}
+
+    template <size_t I>
+    column_type<I> &get(size_t i) {return std::get<I>(cols)[i];}
+    template <size_t I>
+    column_type<I> const &get(size_t i) const {return std::get<I>(cols)[i];}
+
+    auto slice(size_t ss, size_t ee) const {
+      return delayed_seq<value_type>(ee - ss, [this, ss] (size_t i) {
+	  return (*this)[ss + i];});}
+    auto slice() const {return slice(0, n);}
+
+    // A Seq over columns I, J, ...  whose elements are tuples of just
+    // those fields (a pair if there are two).
+    template <size_t... Is>
+    auto zip() const {
+      using Z = typename std::conditional<sizeof...(Is) == 2,
+	std::pair<column_type<Is>...>,
+	std::tuple<column_type<Is>...>>::type;
+      return delayed_seq<Z>(n, [this] (size_t i) {
+	  return Z(std::get<Is>(cols)[i]...);});
+    }
+
+    // back to a sequence of tuples
+    sequence<value_type> to_aos() const {
+      return sequence<value_type>(n, [&] (size_t i) {return (*this)[i];});}
+
+    // Returns the sequence with element i equal to element perm[i] of
+    // this one, gathering every column in the same parallel loop.
+    template <class Idx_Seq>
+    soa_sequence permute(Idx_Seq const &perm) const {
+      soa_sequence r = no_init(perm.size());
+      parallel_for(0, perm.size(), [&] (size_t i) {
+	  r.copy_element(i, *this, perm[i], std::index_sequence_for<Ts...>());});
+      return r;
+    }
+
+  private:
+    size_t n;
+    std::tuple<sequence<Ts>...> cols;
+
+    template <size_t... Is>
+    bool same_sizes(std::index_sequence<Is...>) const {
+      return ((std::get<Is>(cols).size() == n) && ...);}
+    template <class C, class... Cs>
+    static size_t first_size(C const &c, Cs const &...) {return c.size();}
+
+    template <class E, size_t... Is>
+    void init_element(size_t i, E const &e, std::index_sequence<Is...>) {
+      (assign_uninitialized(std::get<Is>(cols)[i],
+			    (column_type<Is>) std::get<Is>(e)), ...);}
+
+    template <size_t... Is>
+    value_type get_element(size_t i, std::index_sequence<Is...>) const {
+      return value_type(std::get<Is>(cols)[i]...);}
+
+    template <size_t... Is>
+    void assign(size_t i, value_type const &v, std::index_sequence<Is...>) {
+      ((std::get<Is>(cols)[i] = std::get<Is>(v)), ...);}
+
+    template <size_t... Is>
+    void copy_element(size_t i, soa_sequence const &a, size_t j,
+		      std::index_sequence<Is...>) {
+      (assign_uninitialized(std::get<Is>(cols)[i], std::get<Is>(a.cols)[j]),
+       ...);}
+  };
+
+  // The permutation that stably sorts A by column I, and then A gathered
+  // by it.  The sort only moves (key, index) pairs.
+  template <size_t I, class Idx=uint, class... Ts, class Compare>
+  sequence<Idx> sort_permutation(soa_sequence<Ts...> const &A,
+				 Compare const &less) {
+    using K = typename soa_sequence<Ts...>::template column_type<I>;
+    using P = std::pair<K,Idx>;
+    auto const &keys = A.template column<I>();
+    auto ki = delayed_seq<P>(A.size(), [&] (size_t i) {
+	return P(keys[i], (Idx) i);});
+    auto sorted = sample_sort(ki, [&] (P const &a, P const &b) {
+	return less(a.first, b.first);}, true);
+    return sequence<Idx>(A.size(), [&] (size_t i) {return sorted[i].second;});
+  }
+
+  template <size_t I, class... Ts, class Compare>
+  soa_sequence<Ts...> sort_by_column(soa_sequence<Ts...> const &A,
+				     Compare const &less) {
+    return A.permute(sort_permutation<I>(A, less));
+  }
+
+  // Same for an unsigned integer key column, using a radix sort on the
+  // low key_bits bits (0 means compute it from the maximum key).
+  template <size_t I, class Idx=uint, class... Ts>
+  sequence<Idx> integer_sort_permutation(soa_sequence<Ts...> const &A,
+					 size_t key_bits=0) {
+    using K = typename soa_sequence<Ts...>::template column_type<I>;
+    using P = std::pair<K,Idx>;
+    if (A.size() == 0) return sequence<Idx>();
+    auto const &keys = A.template column<I>();
+    auto ki = sequence<P>(A.size(), [&] (size_t i) {
+	return P(keys[i], (Idx) i);});
+    auto sorted = integer_sort(ki, [] (P const &a) {return a.first;}, key_bits);
+    return sequence<Idx>(A.size(), [&] (size_t i) {return sorted[i].second;});
+  }
+
+  template <size_t I, class... Ts>
+  soa_sequence<Ts...> integer_sort_by_column(soa_sequence<Ts...> const &A,
+					     size_t key_bits=0) {
+    return A.permute(integer_sort_permutation<I>(A, key_bits));
+  }
+}
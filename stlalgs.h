@@ -14,6 +14,9 @@ namespace pbbs {
     return r;
   }
 
+  // The first i such that p(i), or n if none.  Searches blocks of
+  // doubling size so the work is proportional to the answer, and within
+  // a block stops starting chunks past the leftmost hit found so far.
   template<class IntegerPred>
   size_t find_if_index(size_t n, IntegerPred p, size_t granularity=1000) {
     size_t i;
@@ -22,13 +25,15 @@ namespace pbbs {
     if (i == n) return n;
     size_t start = granularity;
     size_t block_size = 2 * granularity;
-    i = n;
+    std::atomic<size_t> found(n);
     while (start < n) {
       size_t end = std::min(n, start + block_size);
-      parallel_for(start, end, [&] (size_t j) {
-	  if (p(j)) write_min(&i, j, std::less<size_t>());
-	}, granularity);
-      if (i < n) return i;
+      parallel_for_until(start, end, [&] (size_t j) {
+	  if (j < found.load(std::memory_order_relaxed) && p(j))
+	    write_min(&found, j, std::less<size_t>());},
+	[&] (size_t j) {return j >= found.load(std::memory_order_relaxed);},
+	granularity);
+      if ((i = found.load()) < n) return i;
       start += block_size;
       block_size *= 2;
     }
@@ -47,14 +52,17 @@ namespace pbbs {
   size_t count(Seq const &S, T const &value) {
     return count_if_index(S.size(), [&] (size_t i) {return S[i] == value;});}
 
+  // These stop as soon as the answer is known (see find_if_index).
   template<class Seq, class UnaryPred>
-  bool all_of(Seq const &S, UnaryPred p) { return count_if(S, p) == S.size();}
+  bool all_of(Seq const &S, UnaryPred p) {
+    return find_if_index(S.size(), [&] (size_t i) {return !p(S[i]);}) == S.size();}
 
   template<class Seq, class UnaryPred>
-  bool any_of(Seq const &S, UnaryPred p) { return count_if(S, p) > 1;}
+  bool any_of(Seq const &S, UnaryPred p) {
+    return find_if_index(S.size(), [&] (size_t i) {return p(S[i]);}) < S.size();}
 
   template<class Seq, class UnaryPred>
-  bool none_of(Seq const &S, UnaryPred p) { return count_if(S, p) == 0;}
+  bool none_of(Seq const &S, UnaryPred p) { return !any_of(S, p);}
 
   template<class Seq, class UnaryPred>
   size_t find_if(Seq const &S, UnaryPred p) {
@@ -201,11 +209,132 @@ namespace pbbs {
     return (reduce(B, addm<size_t>()) != 0);}
 
   template <class Seq, class UnaryPred>
-  size_t remove_if(Seq const &S, UnaryPred f) {
+  sequence<typename Seq::value_type> remove_if(Seq const &S, UnaryPred f) {
     using T = typename Seq::value_type;
     return filter(S, [&] (T a) {return !f(a);});
   }
 
+  // In-place versions of reverse, rotate, unique and remove_if.  They
+  // take a range and use O(number of blocks) extra space.  unique and
+  // remove_if return the new size, leaving moved-from elements after it.
+
+  template <class Iter>
+  void reverse_inplace(range<Iter> A) {
+    size_t n = A.size();
+    parallel_for(0, n/2, [&] (size_t i) {
+	std::swap(A[i], A[n-i-1]);}, 2048);
+  }
+
+  // Same result as rotate(A, r), by three reversals.
+  template <class Iter>
+  void rotate_inplace(range<Iter> A, size_t r) {
+    size_t n = A.size();
+    if (n == 0 || (r %= n) == 0) return;
+    reverse_inplace(A);
+    par_do([&] () {reverse_inplace(A.slice(0, r));},
+	   [&] () {reverse_inplace(A.slice(r, n));});
+  }
+
+  // Block size for the in-place packs: at least 16 blocks per worker so
+  // the local passes balance, but not so small that the gather loop,
+  // which goes over the blocks in order, dominates.
+  inline size_t inplace_block_size(size_t n) {
+    return std::max<size_t>(4096, n / (16 * num_workers()) + 1);
+  }
+
+  // Moves A[s, s+c) left by d > 0, to A[s-d, s-d+c), in parallel.  If d
+  // is large, in rounds of d (the rounds do not overlap).  Otherwise the
+  // destination is cut into chunks of size L >= d, each of which gets
+  // its elements from itself except for its last d, which come from the
+  // first d of the next chunk.  Those are first saved to a buffer, so
+  // the chunks can then all move at once.
+  template <class Iter>
+  void shift_left_inplace(range<Iter> A, size_t s, size_t c, size_t d) {
+    using T = typename std::iterator_traits<Iter>::value_type;
+    size_t o = s - d;
+    if (d >= 4096) {
+      for (size_t j = 0; j < c; j += d)
+	parallel_for(j, std::min(c, j + d), [&] (size_t i) {
+	    A[o + i] = std::move(A[s + i]);}, 1024);
+      return;
+    }
+    constexpr size_t L = 4 * 4096;
+    auto it = A.begin();
+    if (c <= L) {std::move(it + s, it + s + c, it + o); return;}
+    size_t nc = (c + L - 1) / L;
+    auto tmp = sequence<T>::no_init((nc - 1) * d);
+    parallel_for(1, nc, [&] (size_t j) {
+	for (size_t k = 0; k < d; k++)
+	  assign_uninitialized(tmp[(j-1)*d + k], std::move(A[o + j*L + k]));
+      }, 1);
+    parallel_for(0, nc, [&] (size_t j) {
+	size_t b = o + j*L;
+	if (j + 1 == nc) std::move(it + b + d, it + s + c, it + b);
+	else {
+	  std::move(it + b + d, it + b + L, it + b);
+	  std::move(tmp.begin() + j*d, tmp.begin() + (j+1)*d, it + b + L - d);
+	}}, 1);
+  }
+
+  // Each block b of size bs has its counts[b] kept elements at its
+  // start.  Moves them together to the front of A and returns the total.
+  // The blocks are moved left to right, each by the number of elements
+  // removed before it.
+  template <class Iter>
+  size_t gather_blocks_inplace(range<Iter> A, size_t bs,
+			       sequence<size_t> &counts) {
+    size_t nb = counts.size();
+    size_t o = 0;
+    for (size_t b = 0; b < nb; b++) {
+      size_t s = b * bs, c = counts[b];
+      if (s != o && c != 0) shift_left_inplace(A, s, c, s - o);
+      o += c;
+    }
+    return o;
+  }
+
+  template <class Iter, class UnaryPred>
+  size_t remove_if_inplace(range<Iter> A, UnaryPred f) {
+    size_t n = A.size();
+    size_t bs = inplace_block_size(n);
+    size_t nb = (n + bs - 1) / bs;
+    sequence<size_t> counts = sequence<size_t>::no_init(nb);
+    parallel_for(0, nb, [&] (size_t b) {
+	size_t s = b * bs, e = std::min(n, s + bs), k = s;
+	for (size_t i = s; i < e; i++)
+	  if (!f(A[i])) {
+	    if (k != i) A[k] = std::move(A[i]);
+	    k++;
+	  }
+	counts[b] = k - s;}, 1);
+    return gather_blocks_inplace(A, bs, counts);
+  }
+
+  // Keeps the first of each run of equal elements.  Within a block each
+  // element is compared to the last kept one (as std::unique does),
+  // which by transitivity is equal to its original predecessor iff it
+  // is, so only the first element of each block needs its original
+  // predecessor, and that is checked before anything moves.
+  template <class Iter, class Eql>
+  size_t unique_inplace(range<Iter> A, Eql eq) {
+    size_t n = A.size();
+    size_t bs = inplace_block_size(n);
+    size_t nb = (n + bs - 1) / bs;
+    sequence<bool> first(nb, [&] (size_t b) {
+	return b == 0 || !eq(A[b*bs - 1], A[b*bs]);});
+    sequence<size_t> counts = sequence<size_t>::no_init(nb);
+    parallel_for(0, nb, [&] (size_t b) {
+	size_t s = b * bs, e = std::min(n, s + bs);
+	size_t k = s + first[b];
+	for (size_t i = s + 1; i < e; i++)
+	  if (!eq(A[(k > s) ? k - 1 : s], A[i])) {
+	    if (k != i) A[k] = std::move(A[i]);
+	    k++;
+	  }
+	counts[b] = k - s;}, 1);
+    return gather_blocks_inplace(A, bs, counts);
+  }
+
   template <class Seq, class Compare>
   sequence<typename Seq::value_type>
   sort(Seq const &S, Compare less) {
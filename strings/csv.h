@@ -0,0 +1,249 @@
+// This code is part of the Problem Based Benchmark Suite (PBBS)
+// Copyright (c) 2011-2019 Guy Blelloch and the PBBS team
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights (to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+// LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// Parallel reader for delimited files (CSV, TSV, ...).
+//
+// Fields can be quoted, in which case they can contain the delimiter,
+// line breaks, and quotes (written as two quotes), as in RFC 4180.
+// Records end with \n (or \r\n).  Every record must have the same
+// number of fields.  Blank lines at the end are ignored.
+//
+// The separators are found in three parallel passes over 64 character
+// words of bitmasks (see char_set in string_basics.h):
+//   1) the parity of the number of quotes in each block, then a scan
+//      giving whether each block starts inside quotes
+//   2) a mask per word of the characters inside quotes (a prefix xor
+//      of the quote mask)
+//   3) pack_index_bits on the delimiters and line breaks not in quotes
+// The table keeps just the separator positions.  Fields are returned as
+// ranges into the buffer, or parsed into typed columns on request.
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <stdexcept>
+#include "string_basics.h"
+
+namespace pbbs {
+
+  struct csv_table;
+
+  // Parses S, which must outlive the table.
+  //    delim : the field delimiter, e.g. ',' or '\t'
+  //    header : if true the first record gives the column names
+  //    quote : the quote character, or 0 for no quoting
+  // Throws std::runtime_error on an unterminated quote or a record with
+  // the wrong number of fields.
+  inline csv_table parse_csv(range<char*> S, char delim = ',',
+			     bool header = true, char quote = '"');
+
+  // Same, but maps the file, which the table keeps until destructed.
+  inline csv_table read_csv(std::string filename, char delim = ',',
+			    bool header = true, char quote = '"');
+
+  struct csv_table {
+    size_t num_rows() const {return rows;}
+    size_t num_cols() const {return cols;}
+    std::vector<std::string> const &names() const {return col_names;}
+
+    // index of the column with the given name, throws if there is none
+    size_t column_index(std::string const &name) const {
+      for (size_t j = 0; j < cols; j++)
+	if (col_names[j] == name) return j;
+      throw std::invalid_argument("csv: no column named " + name);
+    }
+
+    // A field of a data row (not including the header) as a range into
+    // the buffer, without its enclosing quotes.  Doubled quotes inside
+    // are left as is (see field_string).
+    range<char*> field(size_t i, size_t j) const {
+      return raw_field((i + (has_header ? 1 : 0)) * cols + j);
+    }
+
+    // A copy of the field with doubled quotes replaced by single ones.
+    sequence<char> field_string(size_t i, size_t j) const {
+      return unescape(field(i, j));
+    }
+
+    // Column j parsed as integers or floating point (using the
+    // parsers in string_basics.h).  An empty field gives 0.
+    template <class T>
+    sequence<T> column(size_t j) const {
+      static_assert(std::is_arithmetic<T>::value,
+		    "csv column type must be arithmetic, see string_column");
+      return sequence<T>(rows, [&] (size_t i) {
+	  range<char*> f = field(i, j);
+	  if constexpr (std::is_floating_point<T>::value)
+	    return f.size() == 0 ? (T) 0 : parse_float<T>(f.begin(), f.end());
+	  else return parse_integer<T>(f.begin(), f.end());});
+    }
+
+    // Column j as ranges into the buffer (no copying).
+    sequence<range<char*>> column_ranges(size_t j) const {
+      return sequence<range<char*>>(rows, [&] (size_t i) {
+	  return field(i, j);});
+    }
+
+    // Column j as strings, with doubled quotes replaced.
+    sequence<sequence<char>> string_column(size_t j) const {
+      return sequence<sequence<char>>(rows, [&] (size_t i) {
+	  return field_string(i, j);});
+    }
+
+  private:
+    friend csv_table parse_csv(range<char*>, char, bool, char);
+    friend csv_table read_csv(std::string, char, bool, char);
+
+    range<char*> str;
+    char quote;
+    bool has_header;
+    size_t rows, cols;
+    size_t num_fields;
+    sequence<size_t> seps; // the separator ending each field
+    std::vector<std::string> col_names;
+    std::unique_ptr<mapped_file> file;
+
+    range<char*> raw_field(size_t k) const {
+      char* s = str.begin();
+      size_t start = (k == 0) ? 0 : seps[k-1] + 1;
+      size_t end = (k < seps.size()) ? seps[k] : str.size();
+      if ((k + 1) % cols == 0 && end > start && s[end-1] == '\r') end--;
+      if (quote != 0 && end - start >= 2 &&
+	  s[start] == quote && s[end-1] == quote) {
+	start++; end--;}
+      return range<char*>(s + start, s + end);
+    }
+
+    sequence<char> unescape(range<char*> f) const {
+      if (quote == 0) return sequence<char>(f);
+      std::string r;
+      for (size_t i = 0; i < f.size(); i++) {
+	r.push_back(f[i]);
+	if (f[i] == quote && i + 1 < f.size() && f[i+1] == quote) i++;
+      }
+      return sequence<char>(r.size(), [&] (size_t i) {return r[i];});
+    }
+  };
+
+  // prefix xor of the bits of x, i.e. bit i is the parity of bits 0..i
+  inline uint64_t prefix_xor(uint64_t x) {
+    x ^= x << 1; x ^= x << 2; x ^= x << 4;
+    x ^= x << 8; x ^= x << 16; x ^= x << 32;
+    return x;
+  }
+
+  inline csv_table parse_csv(range<char*> S, char delim,
+			     bool header, char quote) {
+    timer t("parse_csv", false);
+    size_t n = S.size();
+    const char* s = S.begin();
+    size_t nw = (n + 63) / 64;
+    char_set quotes(quote == 0 ? std::string() : std::string(1, quote));
+    char_set separators(std::string(1, delim) + "\n");
+    auto quote_mask = [&] (size_t j) {
+      return quotes.mask(s + 64 * j, n - 64 * j);};
+
+    // whether each block of words starts inside quotes
+    size_t block_size = _block_size;
+    size_t nb = num_blocks(nw, block_size);
+    sequence<size_t> parity(nb);
+    sliced_for(nw, block_size, [&] (size_t i, size_t st, size_t e) {
+	size_t c = 0;
+	for (size_t j = st; j < e; j++) c += __builtin_popcountll(quote_mask(j));
+	parity[i] = c & 1;});
+    size_t total = scan_inplace(parity.slice(), xorm<size_t>());
+    if (total & 1) throw std::runtime_error("csv: unterminated quote");
+    t.next("quote parity");
+
+    // mask of characters inside quotes for each word
+    sequence<uint64_t> in_quotes = sequence<uint64_t>::no_init(nw);
+    sliced_for(nw, block_size, [&] (size_t i, size_t st, size_t e) {
+	uint64_t carry = parity[i] ? ~((uint64_t) 0) : 0;
+	for (size_t j = st; j < e; j++) {
+	  uint64_t m = prefix_xor(quote_mask(j)) ^ carry;
+	  in_quotes[j] = m;
+	  carry = (m >> 63) ? ~((uint64_t) 0) : 0;
+	}});
+    t.next("in quotes");
+
+    csv_table r;
+    r.seps = pack_index_bits<size_t>(n, [&] (size_t j) {
+	return separators.mask(s + 64 * j, n - 64 * j) & ~in_quotes[j];});
+    t.next("separators");
+
+    // a last record ended by a line break has no field after it
+    size_t m = r.seps.size();
+    bool ends_in_break = (m > 0 && r.seps[m-1] == n - 1 && s[n-1] == '\n');
+    size_t nf = (n == 0) ? 0 : (ends_in_break ? m : m + 1);
+
+    // drop blank lines at the end, i.e. records of one empty field
+    auto blank_record = [&] (size_t k) {
+      size_t start = (k == 0) ? 0 : r.seps[k-1] + 1;
+      size_t end = (k < m) ? r.seps[k] : n;
+      return ((k == 0 || s[r.seps[k-1]] == '\n') &&
+	      (end == start || (end == start + 1 && s[start] == '\r')));};
+    while (nf > 0 && blank_record(nf - 1)) nf--;
+    r.str = S;
+    r.quote = quote;
+    r.has_header = header;
+    r.num_fields = nf;
+    if (nf == 0) {
+      r.rows = r.cols = 0;
+      return r;
+    }
+
+    // every record must have the same number of fields
+    auto ends_record = delayed_seq<bool>(nf, [&] (size_t k) {
+	return k >= m || s[r.seps[k]] == '\n';});
+    sequence<size_t> record_ends = pack_index<size_t>(ends_record);
+    size_t cols = record_ends[0] + 1;
+    size_t num_records = record_ends.size();
+    size_t bad = find_if_index(num_records, [&] (size_t i) {
+	return record_ends[i] != (i + 1) * cols - 1;});
+    if (bad < num_records) {
+      size_t fields = record_ends[bad] - ((bad == 0) ? 0 : record_ends[bad-1] + 1) + 1;
+      throw std::runtime_error("csv: record " + std::to_string(bad) +
+			       " has " + std::to_string(fields) +
+			       " fields, expected " + std::to_string(cols));
+    }
+    r.cols = cols;
+    r.rows = num_records - (header ? 1 : 0);
+    if (header)
+      for (size_t j = 0; j < cols; j++) {
+	sequence<char> name = r.unescape(r.raw_field(j));
+	r.col_names.push_back(std::string(name.begin(), name.end()));
+      }
+    t.next("records");
+    return r;
+  }
+
+  inline csv_table read_csv(std::string filename, char delim,
+			    bool header, char quote) {
+    auto file = std::unique_ptr<mapped_file>(new mapped_file(filename));
+    csv_table r = parse_csv(file->slice(), delim, header, quote);
+    r.file = std::move(file);
+    return r;
+  }
+
+}
@@ -0,0 +1,413 @@
+// This code is part of the Problem Based Benchmark Suite (PBBS)
+// Copyright (c) 2011-2019 Guy Blelloch and the PBBS team
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights (to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+// LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// The back end of a bzip2 style compressor, to be applied to the
+// output of a Burrows-Wheeler transform:
+//   1) move-to-front, which turns the runs of equal characters left by
+//      the transform into runs of zeros
+//   2) run-length coding of the zeros, with the lengths written in
+//      bijective base 2 using two symbols (RUNA and RUNB as in bzip2).
+//      Other values v become symbol v+1, so there are 257 symbols.
+//   3) canonical Huffman coding of the symbols
+// The input is cut into blocks that are coded independently (the
+// move-to-front table starts over in each), so all three steps run in
+// parallel across blocks.  The Huffman code is shared by all blocks and
+// built from a histogram of the symbols.  Each block is then coded at
+// a byte offset given by a scan of the block sizes in bits, so blocks
+// are also decoded in parallel.
+//
+// Format of the encoding:
+//   header (magic, length, block size, number of blocks, data bytes)
+//   code lengths, one byte per symbol
+//   byte offset of each block in the data, plus the total
+//   number of symbols in each block
+//   data
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <stdexcept>
+#include "../sequence.h"
+#include "../integer_sort.h"
+#include "../histogram.h"
+
+namespace pbbs {
+
+  // Encodes S, which can be any sequence of unsigned char.
+  template <class Seq>
+  sequence<char> entropy_encode(Seq const &S, size_t block_size = 1 << 20);
+
+  // Inverse of entropy_encode, where E is contiguous.
+  // Throws std::runtime_error if E is not a valid encoding.
+  template <class CharSeq>
+  sequence<unsigned char> entropy_decode(CharSeq const &E);
+
+  // In place move-to-front coding of a block
+  inline void move_to_front_encode(unsigned char* s, size_t n) {
+    unsigned char table[256];
+    for (int i = 0; i < 256; i++) table[i] = i;
+    for (size_t i = 0; i < n; i++) {
+      unsigned char c = s[i];
+      int j = 0;
+      while (table[j] != c) j++;
+      memmove(table + 1, table, j);
+      table[0] = c;
+      s[i] = j;
+    }
+  }
+
+  inline void move_to_front_decode(unsigned char* s, size_t n) {
+    unsigned char table[256];
+    for (int i = 0; i < 256; i++) table[i] = i;
+    for (size_t i = 0; i < n; i++) {
+      int j = s[i];
+      unsigned char c = table[j];
+      memmove(table + 1, table, j);
+      table[0] = c;
+      s[i] = c;
+    }
+  }
+
+  namespace entropy {
+    using symbol = uint16_t;
+    constexpr int num_symbols = 257;
+    constexpr symbol runa = 0, runb = 1;
+    constexpr int max_code_length = 20;
+    constexpr int fast_bits = 10;  // bits resolved by the decode table
+
+    // writes a run of r > 0 zeros in bijective base 2
+    inline symbol* write_run(size_t r, symbol* out) {
+      while (r > 0) {
+	*out++ = (r & 1) ? runa : runb;
+	r = (r - 1) / 2;
+      }
+      return out;
+    }
+
+    // run-length codes n move-to-front values, returning the number of
+    // symbols, which is at most n
+    inline size_t run_length_encode(const unsigned char* s, size_t n,
+				    symbol* out) {
+      symbol* start = out;
+      size_t run = 0;
+      for (size_t i = 0; i < n; i++) {
+	if (s[i] == 0) run++;
+	else {
+	  out = write_run(run, out);
+	  run = 0;
+	  *out++ = s[i] + 1;
+	}
+      }
+      out = write_run(run, out);
+      return out - start;
+    }
+
+    // returns the number of values written, or n+1 if more than n
+    inline size_t run_length_decode(const symbol* in, size_t m,
+				    unsigned char* s, size_t n) {
+      size_t k = 0;
+      for (size_t i = 0; i < m; ) {
+	if (in[i] <= runb) {
+	  size_t run = 0, digit = 1;
+	  for (; i < m && in[i] <= runb; i++, digit *= 2) {
+	    if (digit > n) return n + 1;
+	    run += (in[i] + 1) * digit;
+	  }
+	  if (run > n - k) return n + 1;
+	  memset(s + k, 0, run);
+	  k += run;
+	} else {
+	  if (k == n) return n + 1;
+	  s[k++] = in[i++] - 1;
+	}
+      }
+      return k;
+    }
+
+    // Huffman code lengths from the symbol counts, built by sorting
+    // the used symbols by count and then merging with a second queue
+    // of internal nodes, which is linear after the sort.  If the
+    // longest code is longer than max_code_length the counts are
+    // flattened and the code rebuilt, as in bzip2.
+    inline sequence<uint8_t> code_lengths(sequence<size_t> counts) {
+      int m = counts.size();
+      sequence<uint8_t> lengths(m, (uint8_t) 0);
+      std::vector<int> used;
+      for (int i = 0; i < m; i++) if (counts[i] > 0) used.push_back(i);
+      if (used.size() == 0) return lengths;
+      if (used.size() == 1) {lengths[used[0]] = 1; return lengths;}
+      while (true) {
+	std::sort(used.begin(), used.end(), [&] (int a, int b) {
+	    return counts[a] < counts[b];});
+	size_t k = used.size();
+	// nodes 0..k-1 are leaves, k..2k-2 internal
+	std::vector<size_t> weight(2 * k - 1);
+	std::vector<int> parent(2 * k - 1, -1);
+	for (size_t i = 0; i < k; i++) weight[i] = counts[used[i]];
+	size_t leaf = 0, inner = k;
+	auto take = [&] (size_t next) {
+	  if (leaf < k && (inner >= next || weight[leaf] <= weight[inner]))
+	    return leaf++;
+	  return inner++;
+	};
+	for (size_t next = k; next < 2 * k - 1; next++) {
+	  size_t a = take(next), b = take(next);
+	  weight[next] = weight[a] + weight[b];
+	  parent[a] = parent[b] = next;
+	}
+	// depths, from the root down
+	std::vector<int> depth(2 * k - 1, 0);
+	int longest = 0;
+	for (size_t i = 2 * k - 1; i-- > 0; ) {
+	  if (parent[i] >= 0) depth[i] = depth[parent[i]] + 1;
+	  if (i < k) longest = std::max(longest, depth[i]);
+	}
+	if (longest <= max_code_length) {
+	  for (size_t i = 0; i < k; i++) lengths[used[i]] = depth[i];
+	  return lengths;
+	}
+	for (int i : used) counts[i] = counts[i] / 2 + 1;
+      }
+    }
+
+    // Canonical codes: shorter codes first, and within a length by
+    // symbol.  The codes are read most significant bit first.
+    struct code_table {
+      sequence<uint8_t> lengths;
+      uint32_t codes[num_symbols];
+      // for decoding
+      uint32_t limit[max_code_length + 2]; // first code past length l,
+					   // left justified to max length
+      uint32_t base[max_code_length + 1];  // index in sorted of first of length l
+      uint32_t first[max_code_length + 1]; // first code of length l
+      symbol sorted[num_symbols];
+      uint16_t fast[1 << fast_bits];       // symbol << 5 | length, or 0
+
+      code_table(sequence<uint8_t> const &lens) : lengths(lens) {
+	int count[max_code_length + 1] = {0};
+	for (int s = 0; s < num_symbols; s++) count[lengths[s]]++;
+	count[0] = 0;
+	uint32_t code = 0, idx = 0;
+	for (int l = 1; l <= max_code_length; l++) {
+	  first[l] = code;
+	  base[l] = idx;
+	  code += count[l];
+	  idx += count[l];
+	  limit[l] = code << (max_code_length - l);
+	  code <<= 1;
+	}
+	limit[max_code_length + 1] = ~((uint32_t) 0);
+	uint32_t next[max_code_length + 1];
+	for (int l = 1; l <= max_code_length; l++) next[l] = base[l];
+	for (int s = 0; s < num_symbols; s++) {
+	  int l = lengths[s];
+	  if (l == 0) continue;
+	  codes[s] = first[l] + (next[l] - base[l]);
+	  sorted[next[l]++] = s;
+	}
+	for (int i = 0; i < (1 << fast_bits); i++) fast[i] = 0;
+	for (int s = 0; s < num_symbols; s++) {
+	  int l = lengths[s];
+	  if (l == 0 || l > fast_bits) continue;
+	  uint32_t lo = codes[s] << (fast_bits - l);
+	  for (uint32_t j = 0; j < (1u << (fast_bits - l)); j++)
+	    fast[lo + j] = (s << 5) | l;
+	}
+      }
+
+      // next symbol from the (left justified) max_code_length bits v,
+      // setting l to its length, or num_symbols if v is not a code
+      symbol decode(uint32_t v, int &l) const {
+	uint16_t f = fast[v >> (max_code_length - fast_bits)];
+	if (f != 0) {l = f & 31; return f >> 5;}
+	l = fast_bits + 1;
+	while (v >= limit[l]) l++;
+	if (l > max_code_length) return num_symbols;
+	return sorted[base[l] + (v >> (max_code_length - l)) - first[l]];
+      }
+    };
+
+    // Writes bits most significant first into a byte array
+    struct bit_writer {
+      uint8_t* p;
+      uint64_t buf = 0;
+      int used = 0;
+      bit_writer(uint8_t* p) : p(p) {}
+      void write(uint32_t code, int len) {
+	buf = (buf << len) | code;
+	used += len;
+	while (used >= 8) {used -= 8; *p++ = buf >> used;}
+      }
+      void flush() {if (used > 0) *p++ = buf << (8 - used);}
+    };
+
+    struct header {
+      char magic[8];
+      uint64_t n, block_size, num_blocks, num_bytes;
+    };
+    constexpr const char* magic = "PBBSENT1";
+  }
+
+  template <class Seq>
+  sequence<char> entropy_encode(Seq const &S, size_t block_size) {
+    using namespace entropy;
+    timer t("entropy_encode", false);
+    size_t n = S.size();
+    size_t nb = (n + block_size - 1) / block_size;
+    auto block_len = [&] (size_t b) {
+      return std::min(block_size, n - b * block_size);};
+
+    // move to front and run-length code each block, then pack the
+    // symbols together
+    sequence<symbol> block_syms = sequence<symbol>::no_init(n);
+    sequence<size_t> sym_offsets(nb + 1);
+    parallel_for(0, nb, [&] (size_t b) {
+	size_t s = b * block_size, len = block_len(b);
+	sequence<unsigned char> buf(len, [&] (size_t j) -> unsigned char {
+	    return S[s + j];});
+	move_to_front_encode(buf.begin(), len);
+	sym_offsets[b] = run_length_encode(buf.begin(), len,
+					   block_syms.begin() + s);}, 1);
+    sequence<size_t> sym_counts(sym_offsets.slice(0, nb));
+    size_t m = scan_inplace(sym_offsets.slice(0, nb), addm<size_t>());
+    sym_offsets[nb] = m;
+    sequence<symbol> syms = sequence<symbol>::no_init(m);
+    parallel_for(0, nb, [&] (size_t b) {
+	std::copy(block_syms.begin() + b * block_size,
+		  block_syms.begin() + b * block_size + sym_counts[b],
+		  syms.begin() + sym_offsets[b]);}, 1);
+    t.next("move to front and run length");
+
+    code_table codes(code_lengths(histogram<size_t>(syms, num_symbols)));
+    t.next("build code");
+
+    // bytes for each block, then their offsets
+    sequence<size_t> byte_offsets(nb + 1);
+    parallel_for(0, nb, [&] (size_t b) {
+	size_t bits = 0;
+	for (size_t j = sym_offsets[b]; j < sym_offsets[b+1]; j++)
+	  bits += codes.lengths[syms[j]];
+	byte_offsets[b] = (bits + 7) / 8;}, 1);
+    size_t num_bytes = scan_inplace(byte_offsets.slice(0, nb), addm<size_t>());
+    byte_offsets[nb] = num_bytes;
+
+    header h;
+    memcpy(h.magic, magic, 8);
+    h.n = n; h.block_size = block_size; h.num_blocks = nb;
+    h.num_bytes = num_bytes;
+    size_t lo = sizeof(header);
+    size_t oo = lo + num_symbols;
+    size_t co = oo + (nb + 1) * sizeof(size_t);
+    size_t data = co + nb * sizeof(size_t);
+    sequence<char> out = sequence<char>::no_init(data + num_bytes);
+    memcpy(out.begin(), &h, sizeof(header));
+    memcpy(out.begin() + lo, codes.lengths.begin(), num_symbols);
+    memcpy(out.begin() + oo, byte_offsets.begin(), (nb + 1) * sizeof(size_t));
+    memcpy(out.begin() + co, sym_counts.begin(), nb * sizeof(size_t));
+    t.next("sizes");
+
+    uint8_t* d = (uint8_t*) out.begin() + data;
+    parallel_for(0, nb, [&] (size_t b) {
+	bit_writer w(d + byte_offsets[b]);
+	for (size_t j = sym_offsets[b]; j < sym_offsets[b+1]; j++)
+	  w.write(codes.codes[syms[j]], codes.lengths[syms[j]]);
+	w.flush();}, 1);
+    t.next("huffman encode");
+    return out;
+  }
+
+  template <class CharSeq>
+  sequence<unsigned char> entropy_decode(CharSeq const &E) {
+    using namespace entropy;
+    timer t("entropy_decode", false);
+    const char* e = E.begin();
+    size_t size = E.size();
+    auto bad = [] () {
+      throw std::runtime_error("entropy_decode: not a valid encoding");};
+    header h;
+    if (size < sizeof(header)) bad();
+    memcpy(&h, e, sizeof(header));
+    if (memcmp(h.magic, magic, 8) != 0 || h.block_size == 0) bad();
+    size_t n = h.n, block_size = h.block_size, nb = h.num_blocks;
+    if (nb != (n + block_size - 1) / block_size) bad();
+    size_t lo = sizeof(header);
+    size_t oo = lo + num_symbols;
+    size_t co = oo + (nb + 1) * sizeof(size_t);
+    size_t data = co + nb * sizeof(size_t);
+    if (size != data + h.num_bytes) bad();
+
+    sequence<uint8_t> lengths(num_symbols, [&] (size_t i) {
+	return (uint8_t) e[lo + i];});
+    // lengths must be at most max_code_length and form a prefix code
+    size_t kraft = 0;
+    for (int i = 0; i < num_symbols; i++) {
+      if (lengths[i] > max_code_length) bad();
+      if (lengths[i] > 0) kraft += 1 << (max_code_length - lengths[i]);
+    }
+    if (kraft > (1 << max_code_length)) bad();
+    code_table codes(lengths);
+    sequence<size_t> byte_offsets = sequence<size_t>::no_init(nb + 1);
+    sequence<size_t> sym_counts = sequence<size_t>::no_init(nb);
+    memcpy(byte_offsets.begin(), e + oo, (nb + 1) * sizeof(size_t));
+    memcpy(sym_counts.begin(), e + co, nb * sizeof(size_t));
+    for (size_t b = 0; b < nb; b++)
+      if (byte_offsets[b] > byte_offsets[b+1] ||
+	  sym_counts[b] > block_size) bad();
+    if (byte_offsets[nb] != h.num_bytes) bad();
+    t.next("read header");
+
+    // a copy of the data with padding, so the decoder can always load
+    // 8 bytes at a time
+    size_t nbytes = h.num_bytes;
+    sequence<uint8_t> bytes(nbytes + 8, [&] (size_t i) {
+	return (i < nbytes) ? (uint8_t) e[data + i] : (uint8_t) 0;});
+    t.next("copy");
+
+    // errors are recorded, since they cannot be thrown across workers
+    std::atomic<bool> failed(false);
+    sequence<unsigned char> out = sequence<unsigned char>::no_init(n);
+    parallel_for(0, nb, [&] (size_t b) {
+	size_t start = byte_offsets[b], end = byte_offsets[b+1];
+	size_t m = sym_counts[b];
+	sequence<symbol> syms = sequence<symbol>::no_init(m);
+	size_t bit = 8 * start;
+	for (size_t j = 0; j < m; j++) {
+	  uint64_t w;
+	  memcpy(&w, bytes.begin() + bit / 8, 8);
+	  w = __builtin_bswap64(w) << (bit % 8);
+	  int l;
+	  syms[j] = codes.decode(w >> (64 - max_code_length), l);
+	  if (syms[j] == num_symbols || bit + l > 8 * end) {failed = true; return;}
+	  bit += l;
+	}
+	size_t len = std::min(block_size, n - b * block_size);
+	unsigned char* s = out.begin() + b * block_size;
+	if (run_length_decode(syms.begin(), m, s, len) != len) {
+	  failed = true; return;}
+	move_to_front_decode(s, len);}, 1);
+    if (failed) bad();
+    t.next("decode");
+    return out;
+  }
+}
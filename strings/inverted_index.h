@@ -0,0 +1,345 @@
+// This code is part of the Problem Based Benchmark Suite (PBBS)
+// Copyright (c) 2011-2019 Guy Blelloch and the PBBS team
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights (to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+// LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// An inverted index mapping terms to sorted lists of document ids
+// (e.g. line numbers), with compressed posting lists.
+//
+// Everything is in one contiguous buffer, which is also the on-disk
+// format, so a saved index is loaded by mapping the file:
+//    header (magic, number of terms, blocks and bytes of each part)
+//    term_offsets[num_terms+1]    : into the term characters
+//    block_offsets[num_terms+1]   : first block of each term
+//    counts[num_terms]            : number of documents for each term
+//    blocks[num_blocks]           : (first id, byte offset) per block
+//    term characters, in sorted order
+//    postings
+// Each posting list is cut into blocks of block_size ids.  Within a
+// block the first id is a varint and the rest are varint deltas, so any
+// block can be decoded on its own.  The block table is used as a skip
+// list by the queries, and to decode and intersect in parallel.
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <stdexcept>
+#include "string_basics.h"
+#include "../sample_sort.h"
+#include "../compressed_sequence.h"
+
+namespace pbbs {
+
+  struct inverted_index;
+
+  // Builds an index from a sequence of (term, ids) pairs, one per distinct
+  // term, where a term is a contiguous character sequence (e.g.
+  // sequence<char> or range<char*>) and ids is a sequence of integers.
+  // This is what group_by returns on a sequence of (term, id) pairs.
+  // The ids need not be sorted or distinct.
+  template <class Groups>
+  inverted_index build_inverted_index(Groups &&groups);
+
+  // Maps an index saved with inverted_index::save.
+  // Throws std::runtime_error if the file is not an index.
+  inline inverted_index load_inverted_index(std::string filename);
+
+  struct inverted_index {
+    static constexpr size_t block_size = 128;
+    struct block {uint64_t first; uint64_t offset;};
+
+    size_t num_terms() const {return head()->num_terms;}
+
+    // total bytes, i.e. the size on disk
+    size_t size_in_bytes() const {return data().size();}
+
+    range<char*> term(size_t i) const {
+      return range<char*>(terms() + term_offsets()[i],
+			  terms() + term_offsets()[i+1]);}
+
+    // number of ids for term i
+    size_t count(size_t i) const {return counts()[i];}
+
+    // index of term t, or num_terms() if not present (binary search)
+    size_t find_term(std::string const &t) const {
+      size_t lo = 0, hi = num_terms();
+      while (lo < hi) {
+	size_t mid = (lo + hi) / 2;
+	range<char*> m = term(mid);
+	int c = memcmp(m.begin(), t.data(), std::min(m.size(), t.size()));
+	if (c < 0 || (c == 0 && m.size() < t.size())) lo = mid + 1;
+	else hi = mid;
+      }
+      if (lo < num_terms() && term(lo).size() == t.size() &&
+	  memcmp(term(lo).begin(), t.data(), t.size()) == 0)
+	return lo;
+      return num_terms();
+    }
+
+    // the ids for term i, decoded in parallel by blocks
+    sequence<size_t> postings(size_t i) const {
+      size_t start = block_offsets()[i];
+      size_t nb = block_offsets()[i+1] - start;
+      size_t n = count(i);
+      sequence<size_t> r = sequence<size_t>::no_init(n);
+      parallel_for(0, nb, [&] (size_t b) {
+	  size_t s = b * block_size;
+	  size_t e = std::min(n, s + block_size);
+	  decode_block(start + b, r.begin() + s, e - s);}, 1);
+      return r;
+    }
+
+    // ids containing all of the terms
+    sequence<size_t> query_and(std::vector<std::string> const &ts) const {
+      if (ts.size() == 0) return sequence<size_t>();
+      std::vector<size_t> ids;
+      for (auto &t : ts) {
+	size_t i = find_term(t);
+	if (i == num_terms()) return sequence<size_t>();
+	ids.push_back(i);
+      }
+      // start from the shortest list
+      std::sort(ids.begin(), ids.end(), [&] (size_t a, size_t b) {
+	  return count(a) < count(b);});
+      sequence<size_t> r = postings(ids[0]);
+      for (size_t k = 1; k < ids.size() && r.size() > 0; k++)
+	r = filter_by_term(r, ids[k], true);
+      return r;
+    }
+
+    // ids containing any of the terms
+    sequence<size_t> query_or(std::vector<std::string> const &ts) const {
+      std::vector<size_t> ids;
+      for (auto &t : ts) {
+	size_t i = find_term(t);
+	if (i < num_terms()) ids.push_back(i);
+      }
+      if (ids.size() == 0) return sequence<size_t>();
+      if (ids.size() == 1) return postings(ids[0]);
+      auto all = flatten(tabulate(ids.size(), [&] (size_t k) {
+	    return postings(ids[k]);}));
+      auto sorted = sample_sort(all, std::less<size_t>());
+      return pack(sorted, delayed_seq<bool>(sorted.size(), [&] (size_t i) {
+	    return i == 0 || sorted[i] != sorted[i-1];}));
+    }
+
+    // the ids in A (sorted) that do not contain term t
+    sequence<size_t> query_and_not(sequence<size_t> const &A,
+				   std::string const &t) const {
+      size_t i = find_term(t);
+      if (i == num_terms()) return A;
+      return filter_by_term(A, i, false);
+    }
+
+    void save(std::string filename) const {
+      if (char_seq_to_file(data(), filename) != 0)
+	throw std::runtime_error("inverted_index: could not write " + filename);
+    }
+
+  private:
+    template <class Groups>
+    friend inverted_index build_inverted_index(Groups &&groups);
+    friend inverted_index load_inverted_index(std::string filename);
+
+    struct header {
+      char magic[8];
+      uint64_t num_terms, num_blocks, term_bytes, posting_bytes;
+    };
+    static constexpr const char* magic = "PBBSIDX1";
+
+    sequence<char> own;                 // when built
+    std::unique_ptr<mapped_file> file;  // when loaded
+
+    range<char*> data() const {
+      return file ? file->slice() : range<char*>(own.begin(), own.end());}
+    header* head() const {return (header*) data().begin();}
+    uint64_t* term_offsets() const {return (uint64_t*) (head() + 1);}
+    uint64_t* block_offsets() const {
+      return term_offsets() + head()->num_terms + 1;}
+    uint64_t* counts() const {return block_offsets() + head()->num_terms + 1;}
+    block* blocks() const {return (block*) (counts() + head()->num_terms);}
+    char* terms() const {return (char*) (blocks() + head()->num_blocks);}
+    uint8_t* postings() const {
+      return (uint8_t*) (terms() + head()->term_bytes);}
+
+    static size_t layout_bytes(size_t num_terms, size_t num_blocks,
+			       size_t term_bytes, size_t posting_bytes) {
+      return (sizeof(header) + (3 * num_terms + 2) * sizeof(uint64_t)
+	      + num_blocks * sizeof(block) + term_bytes + posting_bytes);
+    }
+
+    void decode_block(size_t b, size_t* out, size_t n) const {
+      const uint8_t* p = postings() + blocks()[b].offset;
+      size_t v = decode_varint(p);
+      out[0] = v;
+      for (size_t j = 1; j < n; j++) out[j] = (v += decode_varint(p));
+    }
+
+    // Keeps the elements of A (sorted) that are (keep = true) or are not
+    // in the list for term i.  A is processed in parallel chunks, each
+    // of which uses the block table to skip to the first block that could
+    // contain its first element, then merges against the decoded list.
+    sequence<size_t> filter_by_term(sequence<size_t> const &A, size_t i,
+				    bool keep) const {
+      size_t start = block_offsets()[i];
+      size_t nb = block_offsets()[i+1] - start;
+      size_t cnt = count(i);
+      if (cnt == 0) return keep ? sequence<size_t>() : A;
+      block* bl = blocks() + start;
+      sequence<bool> found(A.size());
+      size_t chunk = 1024;
+      parallel_for(0, (A.size() + chunk - 1) / chunk, [&] (size_t c) {
+	  size_t s = c * chunk;
+	  size_t e = std::min(A.size(), s + chunk);
+	  // one past the last block whose first id is <= a, searching from lo
+	  auto seek = [&] (size_t lo, size_t a) {
+	    return std::upper_bound(bl + lo, bl + nb, a,
+	      [] (size_t v, block const &x) {return v < x.first;}) - bl;};
+	  size_t b = seek(0, A[s]);
+	  b = (b == 0) ? 0 : b - 1;
+	  size_t buf[block_size];
+	  size_t bn = 0, bj = 0;
+	  auto load = [&] () {
+	    bn = std::min(block_size, cnt - b * block_size);
+	    decode_block(start + b, buf, bn);
+	    bj = 0;
+	  };
+	  load();
+	  for (size_t j = s; j < e; j++) {
+	    // past the decoded block: skip with the block table, so a
+	    // sparse A does not decode the blocks in between
+	    if (buf[bn-1] < A[j] && b + 1 < nb) {
+	      size_t nb2 = seek(b + 1, A[j]) - 1;
+	      if (nb2 != b) {b = nb2; load();}
+	    }
+	    // advance the list to the first id >= A[j]
+	    while (bj < bn && buf[bj] < A[j]) bj++;
+	    found[j] = (bj < bn && buf[bj] == A[j]) == keep;
+	  }
+	}, 1);
+      return pack(A, found);
+    }
+  };
+
+  template <class Groups>
+  inverted_index build_inverted_index(Groups &&groups) {
+    using B = inverted_index::block;
+    constexpr size_t bs = inverted_index::block_size;
+    timer t("build_inverted_index", false);
+    size_t nt = groups.size();
+
+    // sorted copies of the lists without duplicate ids (the input is
+    // left as is)
+    sequence<sequence<size_t>> lists(nt);
+    sequence<size_t> counts(nt);
+    parallel_for(0, nt, [&] (size_t i) {
+	auto &g = groups[i].second;
+	sequence<size_t> ids(g.size(), [&] (size_t j) {return (size_t) g[j];});
+	auto b = ids.begin(), e = ids.end();
+	if (!std::is_sorted(b, e)) std::sort(b, e);
+	counts[i] = std::unique(b, e) - b;
+	lists[i] = std::move(ids);}, 1);
+    t.next("sort lists");
+
+    // order terms
+    auto term_less = [&] (size_t a, size_t b) {
+      auto &x = groups[a].first, &y = groups[b].first;
+      int c = memcmp(x.begin(), y.begin(), std::min(x.size(), y.size()));
+      return c < 0 || (c == 0 && x.size() < y.size());};
+    auto order = sample_sort(tabulate(nt, [&] (size_t i) {return i;}),
+			     term_less);
+
+    sequence<uint64_t> term_offsets(nt + 1, [&] (size_t i) {
+	return (i == nt) ? 0 : groups[order[i]].first.size();});
+    size_t term_bytes = scan_inplace(term_offsets.slice(), addm<uint64_t>());
+    sequence<uint64_t> block_offsets(nt + 1, [&] (size_t i) {
+	return (i == nt) ? 0 : (counts[order[i]] + bs - 1) / bs;});
+    size_t nb = scan_inplace(block_offsets.slice(), addm<uint64_t>());
+    t.next("offsets");
+
+    // bytes for each block, then the byte offset of each block
+    sequence<uint64_t> block_bytes(nb);
+    parallel_for(0, nt, [&] (size_t i) {
+	auto &ids = lists[order[i]];
+	size_t cnt = counts[order[i]];
+	parallel_for(block_offsets[i], block_offsets[i+1], [&] (size_t b) {
+	    size_t s = (b - block_offsets[i]) * bs;
+	    size_t e = std::min(cnt, s + bs);
+	    size_t bytes = varint_size(ids[s]);
+	    for (size_t j = s + 1; j < e; j++)
+	      bytes += varint_size(ids[j] - ids[j-1]);
+	    block_bytes[b] = bytes;}, 100);
+      }, 1);
+    size_t posting_bytes = scan_inplace(block_bytes.slice(), addm<uint64_t>());
+    t.next("block sizes");
+
+    inverted_index r;
+    size_t total = inverted_index::layout_bytes(nt, nb, term_bytes,
+						posting_bytes);
+    r.own = sequence<char>::no_init(total);
+    auto h = r.head();
+    memcpy(h->magic, inverted_index::magic, 8);
+    h->num_terms = nt;
+    h->num_blocks = nb;
+    h->term_bytes = term_bytes;
+    h->posting_bytes = posting_bytes;
+    parallel_for(0, nt + 1, [&] (size_t i) {
+	r.term_offsets()[i] = term_offsets[i];
+	r.block_offsets()[i] = block_offsets[i];
+	if (i < nt) r.counts()[i] = counts[order[i]];});
+    parallel_for(0, nt, [&] (size_t i) {
+	auto &w = groups[order[i]].first;
+	memcpy(r.terms() + term_offsets[i], w.begin(), w.size());});
+    t.next("terms");
+
+    parallel_for(0, nt, [&] (size_t i) {
+	auto &ids = lists[order[i]];
+	size_t cnt = counts[order[i]];
+	parallel_for(block_offsets[i], block_offsets[i+1], [&] (size_t b) {
+	    size_t s = (b - block_offsets[i]) * bs;
+	    size_t e = std::min(cnt, s + bs);
+	    r.blocks()[b] = B{(uint64_t) ids[s], block_bytes[b]};
+	    uint8_t* p = encode_varint(ids[s], r.postings() + block_bytes[b]);
+	    for (size_t j = s + 1; j < e; j++)
+	      p = encode_varint(ids[j] - ids[j-1], p);}, 100);
+      }, 1);
+    t.next("encode");
+    return r;
+  }
+
+  inline inverted_index load_inverted_index(std::string filename) {
+    inverted_index r;
+    r.file = std::unique_ptr<mapped_file>(new mapped_file(filename));
+    using H = inverted_index::header;
+    auto bad = [&] () {
+      throw std::runtime_error("inverted_index: not an index file: " + filename);};
+    if (r.data().size() < sizeof(H) ||
+	memcmp(r.head()->magic, inverted_index::magic, 8) != 0)
+      bad();
+    H* h = r.head();
+    if (r.data().size() != inverted_index::layout_bytes(h->num_terms, h->num_blocks,
+						     h->term_bytes, h->posting_bytes))
+      bad();
+    return r;
+  }
+
+}
@@ -26,8 +26,13 @@
 #include <fstream>
 #include <string>
 #include <cstring>
+#include <cstdlib>
+#include <type_traits>
+#include <cerrno>
+#include <atomic>
 //#include <charconv> -- not widely available yet
 #include "../sequence.h"
+#include "../nested_sequence.h"
 
 #include <sys/mman.h>
 #include <stdio.h>
@@ -35,6 +40,9 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <unistd.h>
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
 
 namespace pbbs {
 
@@ -44,23 +52,113 @@ namespace pbbs {
   inline sequence<char> char_seq_from_file(std::string filename,
 					   size_t start=0, size_t end=0);
 
-  // Writes a character sequence to a file, returns 0 if successful
+  // Options for mapping files (can be or'ed together)
+  //    fl_map_populate : prefault the whole file when mapping (MAP_POPULATE)
+  //    fl_map_prefault : prefault the whole file by touching each page
+  //                      in parallel after mapping
+  //    fl_map_huge : advise use of (transparent) huge pages
+  //                  only effective if the kernel supports them for files
+  const flags fl_map_populate = (1 << 8);
+  const flags fl_map_prefault = (1 << 9);
+  const flags fl_map_huge = (1 << 10);
+
+  // A read-only memory mapped file, unmapped when destructed.
+  // The kernel is advised that access is sequential and the whole file
+  // will be needed, so it can read ahead.
+  //    throws std::runtime_error if the file cannot be opened or mapped
+  struct mapped_file;
+
+  // Reads a file using mmap, returning it as a range.
+  // The mapping is never unmapped (use mapped_file for that).
+  inline range<char*> char_range_from_file(std::string filename,
+					   flags fl = no_flag);
+
+  // Touches every page of r in parallel, so page faults are taken
+  // across the workers instead of serially by the first pass
+  inline void prefault(range<char*> r);
+
+  // Writes a character sequence to a file, returns 0 if successful.
+  // The file is preallocated and then written in parallel by chunks
+  // using pwrite.  On failure an error is reported on std::cerr.
+  // The sequence must be contiguous (have a begin() returning char*).
   template <class CharSeq>
   int char_seq_to_file(CharSeq const &S, std::string filename);
 
+  // Same as char_seq_to_file, but copies into a shared mapping of the
+  // file in parallel instead of using pwrite.
+  template <class CharSeq>
+  int char_seq_to_file_map(CharSeq const &S, std::string filename);
+
   // Writes a character sequence to a stream
   template <class CharSeq>
   void char_seq_to_stream(CharSeq const &S, std::ostream& os);
 
+  // Parses a character sequence of whitespace separated numbers into a
+  // sequence of T, which can be an integer or floating point type.
+  // Any character <= ' ' is whitespace.  Like atol and strtod, parsing
+  // of each number stops at the first invalid character.
+  // Works directly on the characters (e.g. a mapped file) without
+  // materializing tokens, and S need not be null terminated.
+  template <class T, class Seq>
+  sequence<T> parse_numbers(Seq const &S);
+
+  // Parses a file of whitespace separated numbers, using mmap.
+  template <class T>
+  sequence<T> numbers_from_file(std::string filename);
+
   // Returns a sequence of sequences of characters, one per token.
   // The tokens are the longest contiguous subsequences of non space characters.
   // where spaces are define by the unary predicate is_space.
-  //template <class Seq, class UnaryPred>
-  //sequence<sequence<char>> tokens(Seq const &S, UnaryPred const &is_space);
+  // Str can be given as e.g. short_string to store short tokens inline.
+  //template <class Str=sequence<char>, class Seq, class UnaryPred>
+  //sequence<Str> tokens(Seq const &S, UnaryPred const &is_space);
 
   // similar but the spaces are given as a string
   //  sequence<sequence<char>> tokens(Seq const &S, std::string const &spaces);
 
+  // A set of up to 16 characters that can be tested 64 at a time,
+  // giving a bitmask of positions in the set (AVX2 or SSE2 compares and
+  // movemask when available).  It is also a predicate on a character,
+  // and when used as the is_space argument of tokens, split and their
+  // variants, they use the bitmasks instead of testing each character.
+  struct char_set;
+
+  // Zero-copy version of tokens.  The ranges point into S (which must
+  // be contiguous), so S must outlive the result.
+  template <class Seq, class UnaryPred>
+  sequence<range<char*>>
+  token_ranges(Seq const &S, UnaryPred const &is_space);
+
+  // Offsets-only version of tokens.  Each token is given by the pair of
+  // its start and end offsets in S.  With Idx = uint32_t this takes
+  // 8 bytes per token, and does not hold on to S.
+  template <class Idx, class Seq, class UnaryPred>
+  sequence<std::pair<Idx,Idx>>
+  token_offsets(Seq const &S, UnaryPred const &is_space);
+
+  // Flat version of tokens: the characters of all tokens are stored
+  // contiguously (see nested_sequence.h).
+  template <class Seq, class UnaryPred>
+  nested_sequence<char> tokens_nested(Seq const &S, UnaryPred const &is_space);
+
+  // Splits S into pieces separated by the characters satisfying is_space.
+  // Unlike tokens, consecutive separators give empty pieces, so there is
+  // always one more piece than separators.
+  template <class Seq, class UnaryPred>
+  sequence<sequence<char>> split(Seq const &S, UnaryPred const &is_space);
+
+  // Zero-copy and offsets-only versions of split, as for tokens.
+  template <class Seq, class UnaryPred>
+  sequence<range<char*>>
+  split_ranges(Seq const &S, UnaryPred const &is_space);
+
+  template <class Idx, class Seq, class UnaryPred>
+  sequence<std::pair<Idx,Idx>>
+  split_offsets(Seq const &S, UnaryPred const &is_space);
+
+  template <class Seq, class UnaryPred>
+  nested_sequence<char> split_nested(Seq const &S, UnaryPred const &is_space);
+
   // A more primitive version of tokens.
   // Zeros out all spaces, and returns a pointer to the start of each token.
   // Can be used with c style char* functions on each token since they will be null
@@ -99,49 +197,149 @@ namespace pbbs {
     return sequence<char>(bytes,n);
   }
 
-  // Reads a file using mmap, returning it as a range
-  inline range<char*> char_range_from_file(std::string filename) {
-    // old fashioned c to deal with mmap
-    struct stat sb;
-    int fd = open(filename.c_str(), O_RDONLY);
-    if (fd == -1) { perror("open"); exit(-1);  }
-    if (fstat(fd, &sb) == -1) { perror("fstat"); exit(-1); }
-    if (!S_ISREG (sb.st_mode)) { perror("not a file\n");  exit(-1); }
-    
-    char *p = static_cast<char*>(mmap(0, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0));
-    if (p == MAP_FAILED) { close(fd); perror("mmap"); exit(-1); }
-    if (close(fd) == -1) { perror("close"); exit(-1); }
-    return range<char*>(p, p + sb.st_size);
+  inline void prefault(range<char*> r) {
+    size_t page_size = sysconf(_SC_PAGESIZE);
+    size_t num_pages = (r.size() + page_size - 1) / page_size;
+    char* s = r.begin();
+    // contiguous runs of pages per task so kernel read ahead still works
+    parallel_for(0, num_pages, [&] (size_t i) {
+	volatile char c = s[i * page_size]; (void) c;}, 256);
+  }
+
+  struct mapped_file {
+  public:
+    using value_type = char;
+
+    mapped_file(std::string filename, flags fl = no_flag) : p(NULL), n(0) {
+      // old fashioned c to deal with mmap
+      struct stat sb;
+      int fd = open(filename.c_str(), O_RDONLY);
+      if (fd == -1) error("open", filename);
+      if (fstat(fd, &sb) == -1) { close(fd); error("fstat", filename); }
+      if (!S_ISREG (sb.st_mode)) {
+	close(fd);
+	throw std::runtime_error("mapped_file: not a file: " + filename);}
+      n = sb.st_size;
+      if (n > 0) {
+	int mflags = MAP_PRIVATE;
+#ifdef MAP_POPULATE
+	if (fl & fl_map_populate) mflags |= MAP_POPULATE;
+#endif
+	void* m = mmap(0, n, PROT_READ, mflags, fd, 0);
+	if (m == MAP_FAILED) { close(fd); error("mmap", filename); }
+	p = static_cast<char*>(m);
+	// advice is only a hint, so failures are ignored
+	madvise(p, n, MADV_SEQUENTIAL);
+	madvise(p, n, MADV_WILLNEED);
+#ifdef MADV_HUGEPAGE
+	if (fl & fl_map_huge) madvise(p, n, MADV_HUGEPAGE);
+#endif
+      }
+      if (close(fd) == -1) { clear(); error("close", filename); }
+      if (fl & fl_map_prefault) prefault(slice());
+    }
+
+    mapped_file(mapped_file&& a) : p(a.p), n(a.n) { a.p = NULL; a.n = 0;}
+    mapped_file& operator = (mapped_file&& a) {
+      if (this != &a) {clear(); std::swap(p, a.p); std::swap(n, a.n);}
+      return *this;
+    }
+    mapped_file(mapped_file const &) = delete;
+    mapped_file& operator = (mapped_file const &) = delete;
+
+    ~mapped_file() { clear(); }
+
+    range<char*> slice() const {return range<char*>(p, p + n);}
+    range<char*> slice(size_t s, size_t e) const {
+      return range<char*>(p + s, p + e);}
+    char* begin() const {return p;}
+    char* end() const {return p + n;}
+    size_t size() const {return n;}
+    char& operator[] (size_t i) const {return p[i];}
+
+    // gives up ownership of the mapping, which is then never unmapped
+    range<char*> release() {
+      range<char*> r = slice(); p = NULL; n = 0; return r;}
+
+  private:
+    char* p;
+    size_t n;
+
+    void clear() {
+      if (p != NULL) munmap(p, n);
+      p = NULL; n = 0;
+    }
+
+    static void error(std::string const &call, std::string const &filename) {
+      throw std::runtime_error("mapped_file: " + call + " failed on "
+			       + filename + ": " + strerror(errno));
+    }
+  };
+
+  inline range<char*> char_range_from_file(std::string filename, flags fl) {
+    return mapped_file(filename, fl).release();
+  }
+
+  // reports the failure of a system call while writing filename,
+  // always returns 1 (the error code of the writers)
+  inline int file_write_error(std::string const &call,
+			      std::string const &filename, int err) {
+    std::cerr << "Unable to write file " << filename << ": "
+	      << call << " failed: " << strerror(err) << std::endl;
+    return 1;
+  }
+
+  // Reserves n bytes for fd so parallel writes do not race to extend the
+  // file.  Filesystems without fallocate support fall back to ftruncate.
+  inline int preallocate_file(int fd, size_t n) {
+    if (n == 0) return 0;
+    int err = posix_fallocate(fd, 0, n);
+    if (err == EINVAL || err == EOPNOTSUPP)
+      err = (ftruncate(fd, n) == -1) ? errno : 0;
+    return err;
   }
 
   template <class CharSeq>
-  void char_seq_to_file_map(CharSeq const &S, std::string filename) {
+  int char_seq_to_file_map(CharSeq const &S, std::string filename) {
     size_t n = S.size();
-    timer t;
-    
-    mode_t mode = 600;
-    int fd = open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, mode);
-    if (fd == -1) {perror("open"); exit(-1);}
+    const char* s = S.begin();
+    timer t("char_seq_to_file_map", false);
+
+    int fd = open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if (fd == -1) return file_write_error("open", filename, errno);
 
-    int tr = ftruncate(fd, n + 1);
-    if (tr == -1) {close(fd); perror("truncate"); exit(-1);}
+    // need the file to have its full size before mapping it
+    if (n > 0 && ftruncate(fd, n) == -1) {
+      int err = errno; close(fd);
+      return file_write_error("ftruncate", filename, err);}
     t.next("truncate");
-    
-    char *p = static_cast<char*>(mmap(0, n, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0));
-    if (p == MAP_FAILED) { close(fd); perror("mmap"); exit(-1); }
-    t.next("mmap");
 
-    memcpy(p, S.begin(), n);
-    t.next("pfor");
-    
-    if (munmap(p, n) == -1)
-      { close(fd);  perror("munmap"); exit(-1);}
-    t.next("unmap");
-    
-    close(fd);
+    if (n > 0) {
+      void* m = mmap(0, n, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+      if (m == MAP_FAILED) {
+	int err = errno; close(fd);
+	return file_write_error("mmap", filename, err);}
+      char* p = static_cast<char*>(m);
+      t.next("mmap");
+
+      size_t block_size = 1 << 20;
+      size_t num_blocks = (n + block_size - 1) / block_size;
+      parallel_for(0, num_blocks, [&] (size_t i) {
+	  size_t start = i * block_size;
+	  memcpy(p + start, s + start, std::min(block_size, n - start));}, 1);
+      t.next("copy");
+
+      if (munmap(p, n) == -1) {
+	int err = errno; close(fd);
+	return file_write_error("munmap", filename, err);}
+      t.next("unmap");
+    }
+
+    if (close(fd) == -1) return file_write_error("close", filename, errno);
     t.next("close");
+    return 0;
   }
-  
+
   template <class CharSeq>
   void char_seq_to_stream(CharSeq const &S, std::ostream& os) {
     os.write(S.begin(), S.size());
@@ -149,13 +347,43 @@ namespace pbbs {
 
   template <class CharSeq>
   int char_seq_to_file(CharSeq const &S, std::string filename) {
-    std::ofstream file_stream (filename, std::ios::out | std::ios::binary);
-    if (!file_stream.is_open()) {
-      std::cout << "Unable to open file for writing: " << filename << std::endl;
-      return 1;
-    }
-    char_seq_to_stream(S, file_stream);
-    file_stream.close();
+    size_t n = S.size();
+    const char* s = S.begin();
+    timer t("char_seq_to_file", false);
+
+    int fd = open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (fd == -1) return file_write_error("open", filename, errno);
+
+    int err = preallocate_file(fd, n);
+    if (err != 0) {
+      close(fd);
+      return file_write_error("fallocate", filename, err);}
+    t.next("preallocate");
+
+    // large chunks so each pwrite is efficient, but enough of them
+    // to keep the workers (and the device queue) busy
+    size_t chunk_size = 1 << 22;
+    size_t num_chunks = (n + chunk_size - 1) / chunk_size;
+    std::atomic<int> first_error(0);
+    parallel_for(0, num_chunks, [&] (size_t i) {
+	size_t start = i * chunk_size;
+	size_t end = std::min(start + chunk_size, n);
+	while (start < end && first_error.load() == 0) {
+	  ssize_t r = pwrite(fd, s + start, end - start, start);
+	  if (r > 0) start += r;
+	  else if (r == -1 && errno == EINTR) continue;
+	  else {
+	    int expected = 0;
+	    first_error.compare_exchange_strong(expected, (r == 0) ? EIO : errno);
+	  }
+	}}, 1);
+    t.next("write");
+
+    if (first_error.load() != 0) {
+      close(fd);
+      return file_write_error("pwrite", filename, first_error.load());}
+    if (close(fd) == -1) return file_write_error("close", filename, errno);
+    t.next("close");
     return 0;
   }
 
@@ -176,25 +404,132 @@ namespace pbbs {
 	return sequence<char>(S.slice(Locations[2*i], Locations[2*i+1]));});
   }
 
-  template <class Seq, class UnaryPred>
-  sequence<sequence<char>>
-  tokens(Seq const &S, UnaryPred const &is_space) {
+  struct char_set {
+    static constexpr size_t max_size = 16;
+
+    char_set(std::string const &chars) : n(chars.size()) {
+      if (n > max_size)
+	throw std::invalid_argument("char_set: more than 16 characters");
+      for (size_t i = 0; i < 256; i++) member[i] = false;
+      for (size_t i = 0; i < n; i++) {
+	cs[i] = chars[i];
+	member[(unsigned char) chars[i]] = true;
+      }
+    }
+
+    bool operator()(char c) const {return member[(unsigned char) c];}
+
+    // bit j is set if s[j] is in the set, for j < min(64, len)
+    uint64_t mask(const char* s, size_t len) const {
+      if (len < 64) {
+	uint64_t r = 0;
+	for (size_t j = 0; j < len; j++)
+	  r |= ((uint64_t) member[(unsigned char) s[j]]) << j;
+	return r;
+      }
+#if defined(__AVX2__)
+      __m256i a = _mm256_loadu_si256((const __m256i*) s);
+      __m256i b = _mm256_loadu_si256((const __m256i*) (s + 32));
+      __m256i ea = _mm256_setzero_si256();
+      __m256i eb = _mm256_setzero_si256();
+      for (size_t i = 0; i < n; i++) {
+	__m256i c = _mm256_set1_epi8(cs[i]);
+	ea = _mm256_or_si256(ea, _mm256_cmpeq_epi8(a, c));
+	eb = _mm256_or_si256(eb, _mm256_cmpeq_epi8(b, c));
+      }
+      return ((uint64_t) (uint32_t) _mm256_movemask_epi8(ea) |
+	      ((uint64_t) (uint32_t) _mm256_movemask_epi8(eb) << 32));
+#elif defined(__SSE2__)
+      uint64_t r = 0;
+      for (size_t k = 0; k < 4; k++) {
+	__m128i a = _mm_loadu_si128((const __m128i*) (s + 16 * k));
+	__m128i e = _mm_setzero_si128();
+	for (size_t i = 0; i < n; i++)
+	  e = _mm_or_si128(e, _mm_cmpeq_epi8(a, _mm_set1_epi8(cs[i])));
+	r |= ((uint64_t) (uint16_t) _mm_movemask_epi8(e)) << (16 * k);
+      }
+      return r;
+#else
+      uint64_t r = 0;
+      for (size_t j = 0; j < 64; j++)
+	r |= ((uint64_t) member[(unsigned char) s[j]]) << j;
+      return r;
+#endif
+    }
+
+  private:
+    size_t n;
+    char cs[max_size];
+    bool member[256];
+  };
+
+  // Start and end of each token, interleaved (2 locations per token).
+  template <class Idx, class Seq, class UnaryPred>
+  sequence<Idx> token_locations(Seq const &S, UnaryPred const &is_space) {
     size_t n = S.size();
-    char* s = S.begin();
+    if (n == 0) return sequence<Idx>();
+    const char* s = S.begin();
     sequence<bool> Flags(n+1);
-    if (n == 0) return sequence<sequence<char>>();
 
     parallel_for(1, n, [&] (long i) {
 	Flags[i] = is_space(s[i-1]) != is_space(s[i]);
       }, 10000);
-      
+
     Flags[0] = !is_space(s[0]);
     Flags[n] = !is_space(s[n-1]);
 
-    sequence<long> Locations = pbbs::pack_index<long>(Flags);
-  
-    return sequence<sequence<char>>(Locations.size()/2, [&] (size_t i) {
-	return sequence<char>(S.slice(Locations[2*i], Locations[2*i+1]));});
+    return pbbs::pack_index<Idx>(Flags);
+  }
+
+  // Same, but using the bitmasks of a char_set.  Position i (0 <= i <= n)
+  // is flagged if s[i-1] and s[i] differ in being spaces, treating s[-1]
+  // and s[n] as spaces.
+  template <class Idx, class Seq>
+  sequence<Idx> token_locations(Seq const &S, char_set const &is_space) {
+    size_t n = S.size();
+    if (n == 0) return sequence<Idx>();
+    const char* s = S.begin();
+    return pbbs::pack_index_bits<Idx>(n + 1, [&] (size_t i) {
+	size_t o = 64 * i;
+	uint64_t sp = (o < n) ? is_space.mask(s + o, n - o) : 0;
+	if (n - o < 64) sp |= ~((uint64_t) 0) << (n - o);
+	uint64_t prev = (sp << 1) | ((o == 0) ? 1 : is_space(s[o-1]));
+	uint64_t r = sp ^ prev;
+	if (n + 1 - o < 64) r &= (((uint64_t) 1) << (n + 1 - o)) - 1;
+	return r;});
+  }
+
+  template <class Str=sequence<char>, class Seq, class UnaryPred>
+  sequence<Str>
+  tokens(Seq const &S, UnaryPred const &is_space) {
+    sequence<long> Locations = token_locations<long>(S, is_space);
+    return sequence<Str>(Locations.size()/2, [&] (size_t i) {
+	return Str(S.slice(Locations[2*i], Locations[2*i+1]));});
+  }
+
+  template <class Seq, class UnaryPred>
+  sequence<range<char*>>
+  token_ranges(Seq const &S, UnaryPred const &is_space) {
+    sequence<long> Locations = token_locations<long>(S, is_space);
+    char* s = S.begin();
+    return sequence<range<char*>>(Locations.size()/2, [&] (size_t i) {
+	return range<char*>(s + Locations[2*i], s + Locations[2*i+1]);});
+  }
+
+  template <class Idx, class Seq, class UnaryPred>
+  sequence<std::pair<Idx,Idx>>
+  token_offsets(Seq const &S, UnaryPred const &is_space) {
+    sequence<Idx> Locations = token_locations<Idx>(S, is_space);
+    return sequence<std::pair<Idx,Idx>>(Locations.size()/2, [&] (size_t i) {
+	return std::make_pair(Locations[2*i], Locations[2*i+1]);});
+  }
+
+  template <class Seq, class UnaryPred>
+  nested_sequence<char> tokens_nested(Seq const &S, UnaryPred const &is_space) {
+    sequence<long> Locations = token_locations<long>(S, is_space);
+    return nested_sequence<char>(Locations.size()/2, [&] (size_t i) {
+	return Locations[2*i+1] - Locations[2*i];},
+      [&] (size_t i, size_t j) {return S[Locations[2*i] + j];});
   }
 
   template <class Seq, class UnaryPred>
@@ -234,13 +569,26 @@ namespace pbbs {
 	return range<T*>(S.slice(Starts[i],end));});			    
   }
 
+  // Locations of the separators, there is one more piece than separators
+  template <class Idx, class Seq, class UnaryPred>
+  sequence<Idx> split_locations(Seq const &S, UnaryPred const &is_space) {
+    auto X = delayed_seq<bool>(S.size(), [&] (size_t i) {
+	return is_space(S[i]);});
+    return pbbs::pack_index<Idx>(X);
+  }
+
+  template <class Idx, class Seq>
+  sequence<Idx> split_locations(Seq const &S, char_set const &is_space) {
+    size_t n = S.size();
+    const char* s = S.begin();
+    return pbbs::pack_index_bits<Idx>(n, [&] (size_t i) {
+	return is_space.mask(s + 64 * i, n - 64 * i);});
+  }
+
   template <class Seq, class UnaryPred>
   sequence<sequence<char>> split(Seq const &S, UnaryPred const &is_space) {
     size_t n = S.size();
-
-    auto X = sequence<bool>(n, [&] (size_t i) {
-	return is_space(S[i]);});
-    sequence<long> Locations = pbbs::pack_index<long>(X);
+    sequence<long> Locations = split_locations<long>(S, is_space);
     size_t m = Locations.size();
   
     return tabulate(m + 1, [&] (size_t i) -> sequence<char> {
@@ -249,8 +597,50 @@ namespace pbbs {
 	return sequence<char>(S.slice(start, end));});
   }
 
+  template <class Seq, class UnaryPred>
+  sequence<range<char*>>
+  split_ranges(Seq const &S, UnaryPred const &is_space) {
+    size_t n = S.size();
+    sequence<long> Locations = split_locations<long>(S, is_space);
+    size_t m = Locations.size();
+    char* s = S.begin();
+
+    return sequence<range<char*>>(m + 1, [&] (size_t i) {
+	size_t start = (i==0) ? 0 : Locations[i-1] + 1;
+	size_t end = (i==m) ? n : Locations[i];
+	return range<char*>(s + start, s + end);});
+  }
+
+  template <class Idx, class Seq, class UnaryPred>
+  sequence<std::pair<Idx,Idx>>
+  split_offsets(Seq const &S, UnaryPred const &is_space) {
+    size_t n = S.size();
+    sequence<Idx> Locations = split_locations<Idx>(S, is_space);
+    size_t m = Locations.size();
+
+    return sequence<std::pair<Idx,Idx>>(m + 1, [&] (size_t i) {
+	Idx start = (i==0) ? 0 : Locations[i-1] + 1;
+	Idx end = (i==m) ? n : Locations[i];
+	return std::make_pair(start, end);});
+  }
+
+  template <class Seq, class UnaryPred>
+  nested_sequence<char> split_nested(Seq const &S, UnaryPred const &is_space) {
+    size_t n = S.size();
+    sequence<long> Locations = split_locations<long>(S, is_space);
+    size_t m = Locations.size();
+    auto start = [&] (size_t i) -> size_t {
+      return (i==0) ? 0 : Locations[i-1] + 1;};
+    auto end = [&] (size_t i) -> size_t {return (i==m) ? n : Locations[i];};
+    return nested_sequence<char>(m + 1, [&] (size_t i) {
+	return end(i) - start(i);},
+      [&] (size_t i, size_t j) {return S[start(i) + j];});
+  }
+
   template <class Seq>
   sequence<sequence<char>> split(Seq const &S, std::string const &spaces) {
+    if (spaces.size() <= char_set::max_size)
+      return split(S, char_set(spaces));
     auto is_space = [&] (char a) {
       for (int i = 0; i < spaces.size(); i++)
 	if (a == spaces[i]) return true;
@@ -273,6 +663,150 @@ namespace pbbs {
     else return read_digits();
   }
 
+  inline bool is_number_space(char c) {return (unsigned char) c <= ' ';}
+
+  // If the 8 characters at s are all digits, sets v to their value and
+  // returns true.  Uses SWAR (simd within a register) on a 64 bit word.
+  inline bool parse_eight_digits(const char* s, uint64_t &v) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    uint64_t x;
+    memcpy(&x, s, 8);
+    if (((x & 0xF0F0F0F0F0F0F0F0) |
+	 (((x + 0x0606060606060606) & 0xF0F0F0F0F0F0F0F0) >> 4))
+	!= 0x3333333333333333)
+      return false;
+    x = ((x & 0x0F0F0F0F0F0F0F0F) * 2561) >> 8;
+    x = ((x & 0x00FF00FF00FF00FF) * 6553601) >> 16;
+    v = ((x & 0x0000FFFF0000FFFF) * 42949672960001) >> 32;
+    return true;
+#else
+    return false;
+#endif
+  }
+
+  // parses an integer from [s, e), if end is not null it is set to
+  // the first character not parsed
+  template <class T>
+  T parse_integer(const char* s, const char* e, const char** end = NULL) {
+    using U = typename std::make_unsigned<T>::type;
+    bool neg = false;
+    if (s < e && (*s == '-' || *s == '+')) neg = (*s++ == '-');
+    U r = 0;
+    uint64_t v;
+    for (; s + 8 <= e && parse_eight_digits(s, v); s += 8)
+      r = r * 100000000 + v;
+    for (; s < e; s++) {
+      unsigned d = (unsigned char) *s - '0';
+      if (d > 9) break;
+      r = r * 10 + d;
+    }
+    if (end != NULL) *end = s;
+    return (T) (neg ? (U) 0 - r : r);
+  }
+
+  // parses a floating point number from [s, e).
+  // Numbers with at most 19 significant digits and a decimal exponent
+  // of magnitude at most 22 are exact in a double, so the result is
+  // a single correctly rounded multiply or divide.  Anything else
+  // (including inf and nan) goes to strtod.
+  template <class T>
+  T parse_float(const char* s, const char* e) {
+    static constexpr double pow10[] = {
+      1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+      1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+    const char* start = s;
+    bool neg = false;
+    if (s < e && (*s == '-' || *s == '+')) neg = (*s++ == '-');
+    uint64_t m = 0;
+    int digits = 0, exp = 0;
+    bool any = false;
+    auto read_digits = [&] (bool fraction) {
+      for (; s < e; s++) {
+	unsigned d = (unsigned char) *s - '0';
+	if (d > 9) break;
+	any = true;
+	m = m * 10 + d;
+	if (m > 0) digits++;
+	if (fraction) exp--;
+	if (digits > 19) return;
+      }
+    };
+    read_digits(false);
+    if (s < e && *s == '.') {s++; read_digits(true);}
+    if (any && digits <= 19 && s < e && (*s == 'e' || *s == 'E')) {
+      const char* t = s + 1;
+      bool eneg = false;
+      if (t < e && (*t == '-' || *t == '+')) eneg = (*t++ == '-');
+      if (t < e && (unsigned) (*t - '0') <= 9) {
+	int x = 0;
+	for (; t < e && (unsigned) (*t - '0') <= 9; t++)
+	  if (x < 10000) x = x * 10 + (*t - '0');
+	exp += eneg ? -x : x;
+	s = t;
+      }
+    }
+    if (any && digits <= 19 && m < ((uint64_t) 1 << 53)
+	&& exp >= -22 && exp <= 22) {
+      double r = (double) m;
+      r = (exp < 0) ? r / pow10[-exp] : r * pow10[exp];
+      return (T) (neg ? -r : r);
+    }
+    std::string str(start, e);
+    return (T) strtod(str.c_str(), NULL);
+  }
+
+  template <class T, class Seq>
+  sequence<T> parse_numbers(Seq const &S) {
+    size_t n = S.size();
+    const char* s = S.begin();
+    size_t block_size = 1 << 16;
+    size_t num_blocks = (n + block_size - 1) / block_size;
+
+    // count numbers starting in each block, written so it vectorizes
+    sequence<size_t> offsets(num_blocks);
+    parallel_for(0, num_blocks, [&] (size_t i) {
+	size_t start = std::max<size_t>(i * block_size, 1);
+	size_t end = std::min(n, (i + 1) * block_size);
+	size_t c = (i == 0 && !is_number_space(s[0]));
+	for (size_t j = start; j < end; j++)
+	  c += (!is_number_space(s[j])) & is_number_space(s[j-1]);
+	offsets[i] = c;
+      }, 1);
+    size_t m = scan_inplace(offsets.slice(), addm<size_t>());
+
+    // each block parses the numbers that start in it, possibly reading
+    // past its end
+    sequence<T> R = sequence<T>::no_init(m);
+    parallel_for(0, num_blocks, [&] (size_t i) {
+	size_t j = i * block_size;
+	size_t end = std::min(n, (i + 1) * block_size);
+	size_t k = offsets[i];
+	if (j > 0 && !is_number_space(s[j-1])) // started in previous block
+	  while (j < end && !is_number_space(s[j])) j++;
+	while (j < end) {
+	  if (is_number_space(s[j])) {j++; continue;}
+	  size_t e = j;
+	  if constexpr (std::is_floating_point<T>::value) {
+	    while (e < n && !is_number_space(s[e])) e++;
+	    R[k++] = parse_float<T>(s + j, s + e);
+	  } else {
+	    const char* stop;
+	    R[k++] = parse_integer<T>(s + j, s + n, &stop);
+	    e = stop - s;
+	    while (e < n && !is_number_space(s[e])) e++;
+	  }
+	  j = e;
+	}
+      }, 1);
+    return R;
+  }
+
+  template <class T>
+  sequence<T> numbers_from_file(std::string filename) {
+    mapped_file f(filename);
+    return parse_numbers<T>(f);
+  }
+
   // ********************************
   // Printing to a character sequence
   // ********************************
@@ -312,7 +846,7 @@ namespace pbbs {
     return to_char_seq((double) v);};
 
   sequence<char> to_char_seq(std::string const &s) {
-    return map(s, [&] (char c) {return c;});
+    return sequence<char>(s.size(), [&] (size_t i) {return s[i];});
   }
 
   sequence<char> to_char_seq(const char* s) {
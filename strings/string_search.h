@@ -0,0 +1,458 @@
+// This code is part of the Problem Based Benchmark Suite (PBBS)
+// Copyright (c) 2011-2019 Guy Blelloch and the PBBS team
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights (to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+// LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// Line oriented search of a character buffer, as in grep.
+//
+// A matcher finds lines containing a match.  There are three:
+//    string_matcher : a single string, using a SIMD filter on its first
+//                     and last characters (AVX2 if available)
+//    multi_string_matcher : any of a set of strings (Aho-Corasick)
+//    regex_matcher : a simple regular expression compiled to a DFA
+//
+// Each has a method
+//    const char* find(const char* s, const char* e) const
+// which, given whole lines [s, e), returns a pointer into (or to the
+// end of) the first line with a match, or e if there is none.
+//
+// grep_lines(S, m) returns the lines of S that m matches, as ranges into
+// S (without the line breaks).  The buffer is cut into blocks at line
+// breaks which are then searched in parallel.
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <bitset>
+#include <map>
+#include <cstring>
+#include <stdexcept>
+#include "../sequence.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace pbbs {
+
+  template <class Matcher>
+  sequence<range<char*>> grep_lines(range<char*> S, Matcher const &m);
+
+  struct string_matcher {
+    string_matcher(std::string const &pattern) : pat(pattern) {
+      check_no_line_break(pat);
+    }
+
+    const char* find(const char* s, const char* e) const {
+      size_t m = pat.size();
+      if (m == 0) return s;
+      if ((size_t) (e - s) < m) return e;
+      const char* last = e - m; // last possible start
+      const char* p = s;
+      const char* pt = pat.c_str();
+#if defined(__AVX2__)
+      // candidates are where both the first and last characters match
+      __m256i first = _mm256_set1_epi8(pt[0]);
+      __m256i lst = _mm256_set1_epi8(pt[m-1]);
+      for (; p + 32 <= last + 1; p += 32) {
+	__m256i a = _mm256_loadu_si256((const __m256i*) p);
+	__m256i b = _mm256_loadu_si256((const __m256i*) (p + m - 1));
+	uint32_t mask = _mm256_movemask_epi8(
+		 _mm256_and_si256(_mm256_cmpeq_epi8(a, first),
+				  _mm256_cmpeq_epi8(b, lst)));
+	while (mask) {
+	  const char* c = p + __builtin_ctz(mask);
+	  if (memcmp(c, pt, m) == 0) return c;
+	  mask &= mask - 1;
+	}
+      }
+#endif
+      while (p <= last) {
+	p = (const char*) memchr(p, pt[0], last - p + 1);
+	if (p == NULL) return e;
+	if (memcmp(p, pt, m) == 0) return p;
+	p++;
+      }
+      return e;
+    }
+
+    static void check_no_line_break(std::string const &s) {
+      if (s.find('\n') != std::string::npos)
+	throw std::invalid_argument("pattern cannot contain a line break");
+    }
+
+  private:
+    std::string pat;
+  };
+
+  // Aho-Corasick automaton with the failure links resolved into a full
+  // transition table.  Characters not in any pattern share one class so
+  // the table is states x (distinct characters + 1).
+  struct multi_string_matcher {
+    multi_string_matcher(std::vector<std::string> const &patterns) {
+      for (size_t i = 0; i < 256; i++) cls[i] = 0;
+      nc = 1;
+      for (auto &p : patterns) {
+	string_matcher::check_no_line_break(p);
+	for (char c : p)
+	  if (cls[(unsigned char) c] == 0) cls[(unsigned char) c] = nc++;
+      }
+
+      // build the trie
+      std::vector<int> go(nc, -1);
+      out.push_back(false);
+      for (auto &p : patterns) {
+	size_t s = 0;
+	for (char c : p) {
+	  int &t = go[s * nc + cls[(unsigned char) c]];
+	  if (t == -1) {
+	    t = out.size();
+	    out.push_back(false);
+	    go.resize(go.size() + nc, -1);
+	  }
+	  s = go[s * nc + cls[(unsigned char) c]];
+	}
+	out[s] = true;
+      }
+
+      // breadth first to set failure links and fill in the table
+      size_t ns = out.size();
+      delta = std::vector<int>(ns * nc);
+      std::vector<int> fail(ns, 0);
+      std::vector<int> queue;
+      for (size_t c = 0; c < nc; c++) {
+	int t = go[c];
+	delta[c] = (t == -1) ? 0 : t;
+	if (t != -1) queue.push_back(t);
+      }
+      for (size_t q = 0; q < queue.size(); q++) {
+	int s = queue[q];
+	out[s] = out[s] || out[fail[s]];
+	for (size_t c = 0; c < nc; c++) {
+	  int t = go[s * nc + c];
+	  if (t == -1) delta[s * nc + c] = delta[fail[s] * nc + c];
+	  else {
+	    fail[t] = delta[fail[s] * nc + c];
+	    delta[s * nc + c] = t;
+	    queue.push_back(t);
+	  }
+	}
+      }
+    }
+
+    // returns where the first match ends.  No pattern contains a line
+    // break so the automaton is back at the root at each line start.
+    const char* find(const char* s, const char* e) const {
+      if (out[0]) return s;
+      int st = 0;
+      for (const char* p = s; p < e; p++) {
+	st = delta[st * nc + cls[(unsigned char) *p]];
+	if (out[st]) return p;
+      }
+      return e;
+    }
+
+  private:
+    unsigned char cls[256];
+    size_t nc;
+    std::vector<int> delta;
+    std::vector<bool> out;
+  };
+
+  // A regular expression compiled to a DFA, matched against each line.
+  // Supports: characters, \ to escape, . (any character), [..] classes
+  // with ranges and ^ for negation, (..) grouping, | alternation,
+  // and the * + ? repetitions.  A leading ^ anchors the match to the
+  // start of the line and a trailing $ to the end.
+  // Throws std::invalid_argument on a malformed expression and
+  // std::runtime_error if the DFA would have more than max_states.
+  struct regex_matcher {
+    static constexpr size_t max_states = 10000;
+
+    regex_matcher(std::string const &regex) {
+      std::string r = regex;
+      anchored = r.size() > 0 && r[0] == '^';
+      if (anchored) r = r.substr(1);
+      dollar = (r.size() > 0 && r.back() == '$' &&
+		(r.size() == 1 || r[r.size()-2] != '\\'));
+      if (dollar) r.pop_back();
+      string_matcher::check_no_line_break(r);
+      pos = 0;
+      re = r;
+      frag f = parse_alt();
+      if (pos != re.size()) error("unmatched )");
+      final_state = f.second;
+      build_dfa(f.first);
+    }
+
+    const char* find(const char* s, const char* e) const {
+      while (s < e) {
+	int st = 0;
+	if (!dollar && accept[st]) return s;
+	const char* p = s;
+	for (; p < e && *p != '\n'; p++) {
+	  st = delta[st * nc + cls[(unsigned char) *p]];
+	  if (st == dead) break;
+	  if (!dollar && accept[st]) return p;
+	}
+	// a last line without a line break is not empty, so p-1 is in it
+	if (st != dead && dollar && accept[st]) return (p == e) ? p - 1 : p;
+	if (p < e && *p != '\n') {
+	  p = (const char*) memchr(p, '\n', e - p);
+	  if (p == NULL) return e;
+	}
+	s = p + 1;
+      }
+      return e;
+    }
+
+  private:
+    // Thompson NFA: a state either moves on a character in its set
+    // to next, or has epsilon moves
+    struct nfa_state {
+      int set;
+      int next;
+      std::vector<int> eps;
+    };
+    using frag = std::pair<int,int>; // start and end states
+    std::vector<nfa_state> nfa;
+    std::vector<std::bitset<256>> sets;
+    std::string re;
+    size_t pos;
+    int final_state;
+
+    bool anchored, dollar;
+    unsigned char cls[256];
+    size_t nc;
+    std::vector<int> delta;
+    std::vector<bool> accept;
+    int dead = -1;
+
+    [[noreturn]] void error(std::string const &msg) {
+      throw std::invalid_argument("regex_matcher: " + msg + " in " + re);
+    }
+
+    int new_state() {
+      nfa.push_back(nfa_state{-1, -1, {}});
+      return nfa.size() - 1;
+    }
+
+    frag char_frag(std::bitset<256> const &set) {
+      int s = new_state(), e = new_state();
+      sets.push_back(set);
+      nfa[s].set = sets.size() - 1;
+      nfa[s].next = e;
+      return frag(s, e);
+    }
+
+    frag parse_alt() {
+      frag a = parse_concat();
+      while (pos < re.size() && re[pos] == '|') {
+	pos++;
+	frag b = parse_concat();
+	int s = new_state(), e = new_state();
+	nfa[s].eps = {a.first, b.first};
+	nfa[a.second].eps.push_back(e);
+	nfa[b.second].eps.push_back(e);
+	a = frag(s, e);
+      }
+      return a;
+    }
+
+    frag parse_concat() {
+      int s = new_state();
+      frag a(s, s);
+      while (pos < re.size() && re[pos] != '|' && re[pos] != ')') {
+	frag b = parse_repeat();
+	nfa[a.second].eps.push_back(b.first);
+	a.second = b.second;
+      }
+      return a;
+    }
+
+    frag parse_repeat() {
+      frag a = parse_atom();
+      while (pos < re.size() &&
+	     (re[pos] == '*' || re[pos] == '+' || re[pos] == '?')) {
+	char op = re[pos++];
+	int s = new_state(), e = new_state();
+	nfa[s].eps = {a.first};
+	if (op != '+') nfa[s].eps.push_back(e);
+	nfa[a.second].eps.push_back(e);
+	if (op != '?') nfa[a.second].eps.push_back(a.first);
+	a = frag(s, e);
+      }
+      return a;
+    }
+
+    frag parse_atom() {
+      char c = re[pos++];
+      std::bitset<256> set;
+      switch (c) {
+      case '(': {
+	frag a = parse_alt();
+	if (pos >= re.size() || re[pos] != ')') error("unmatched (");
+	pos++;
+	return a;
+      }
+      case '*': case '+': case '?':
+	error("nothing to repeat");
+      case '.':
+	set.set();
+	set.reset('\n');
+	return char_frag(set);
+      case '[':
+	return char_frag(parse_class());
+      case '\\':
+	if (pos >= re.size()) error("trailing \\");
+	c = re[pos++];
+	// fall through
+      default:
+	set.set((unsigned char) c);
+	return char_frag(set);
+      }
+    }
+
+    std::bitset<256> parse_class() {
+      std::bitset<256> set;
+      bool negate = pos < re.size() && re[pos] == '^';
+      if (negate) pos++;
+      bool first = true;
+      while (pos < re.size() && (first || re[pos] != ']')) {
+	first = false;
+	unsigned char lo = re[pos++];
+	if (lo == '\\' && pos < re.size()) lo = re[pos++];
+	unsigned char hi = lo;
+	if (pos + 1 < re.size() && re[pos] == '-' && re[pos+1] != ']') {
+	  hi = re[pos+1];
+	  pos += 2;
+	}
+	for (size_t i = lo; i <= hi; i++) set.set(i);
+      }
+      if (pos >= re.size()) error("unmatched [");
+      pos++;
+      if (negate) {set.flip(); set.reset('\n');}
+      return set;
+    }
+
+    void closure(std::vector<int> &s) const {
+      std::vector<bool> in(nfa.size(), false);
+      for (int x : s) in[x] = true;
+      for (size_t i = 0; i < s.size(); i++)
+	for (int y : nfa[s[i]].eps)
+	  if (!in[y]) {in[y] = true; s.push_back(y);}
+      std::sort(s.begin(), s.end());
+    }
+
+    // subset construction over classes of characters that no set
+    // distinguishes.  Unless anchored the start states are added to
+    // every DFA state so a match can start anywhere.
+    void build_dfa(int start) {
+      std::map<std::vector<bool>,int> class_of;
+      for (size_t c = 0; c < 256; c++) {
+	std::vector<bool> sig(sets.size());
+	for (size_t i = 0; i < sets.size(); i++) sig[i] = sets[i][c];
+	auto r = class_of.insert(std::make_pair(sig, (int) class_of.size()));
+	cls[c] = r.first->second;
+      }
+      nc = class_of.size();
+      std::vector<unsigned char> rep(nc);
+      for (size_t c = 0; c < 256; c++) rep[cls[c]] = c;
+
+      std::vector<int> init = {start};
+      closure(init);
+      std::map<std::vector<int>,int> ids;
+      std::vector<std::vector<int>> states;
+      auto get_id = [&] (std::vector<int> const &s) {
+	auto r = ids.insert(std::make_pair(s, (int) states.size()));
+	if (r.second) {
+	  if (states.size() == max_states)
+	    throw std::runtime_error("regex_matcher: too many DFA states");
+	  states.push_back(s);
+	  accept.push_back(std::binary_search(s.begin(), s.end(),
+					      final_state));
+	  if (s.empty()) dead = r.first->second;
+	}
+	return r.first->second;
+      };
+      get_id(init);
+      for (size_t i = 0; i < states.size(); i++) {
+	delta.resize((i + 1) * nc);
+	for (size_t c = 0; c < nc; c++) {
+	  std::vector<int> next;
+	  if (!anchored) next = init;
+	  for (int x : states[i])
+	    if (nfa[x].set != -1 && sets[nfa[x].set][rep[c]])
+	      next.push_back(nfa[x].next);
+	  std::sort(next.begin(), next.end());
+	  next.erase(std::unique(next.begin(), next.end()), next.end());
+	  closure(next);
+	  delta[i * nc + c] = get_id(next);
+	}
+      }
+    }
+  };
+
+  template <class Matcher>
+  sequence<range<char*>> grep_lines(range<char*> S, Matcher const &m) {
+    size_t n = S.size();
+    char* s = S.begin();
+    size_t block_size = 1 << 16;
+    size_t num_blocks = (n + block_size - 1) / block_size;
+    if (n == 0) return sequence<range<char*>>();
+
+    // the first line start in each block, or n if there is none.  Each
+    // search stays within its block, so a long line is scanned once.
+    sequence<size_t> first(num_blocks, [&] (size_t i) -> size_t {
+	if (i == 0) return 0;
+	size_t o = i * block_size - 1;
+	const char* p = (const char*) memchr(s + o, '\n', std::min(n - o, block_size));
+	return (p == NULL) ? n : p - s + 1;});
+
+    // move each block boundary forward to the start of a line, i.e. the
+    // first one in this or a later block (a suffix minimum)
+    auto mins = scan(delayed_seq<size_t>(num_blocks, [&] (size_t k) {
+	  return first[num_blocks - 1 - k];}),
+      minm<size_t>(), fl_scan_inclusive).first;
+    sequence<size_t> starts(num_blocks + 1, [&] (size_t i) {
+	return (i == num_blocks) ? n : mins[num_blocks - 1 - i];});
+
+    sequence<sequence<range<char*>>> lines(num_blocks, [&] (size_t i) {
+	std::vector<range<char*>> r;
+	char* p = s + starts[i];
+	char* e = s + starts[i+1];
+	while (p < e) {
+	  char* q = (char*) m.find(p, e);
+	  if (q == e) break;
+	  char* ls = q;
+	  while (ls > p && ls[-1] != '\n') ls--;
+	  char* le = (char*) memchr(q, '\n', e - q);
+	  if (le == NULL) le = e;
+	  r.push_back(range<char*>(ls, le));
+	  p = le + 1;
+	}
+	return sequence<range<char*>>(r.size(), [&] (size_t j) {
+	    return r[j];});
+      }, 1);
+    return flatten(lines);
+  }
+
+}
@@ -185,7 +185,7 @@ namespace pbbs {
 
     // identify segments of equal values
     sequence<indexT> ranks(n);
-    sequence<seg<indexT>> seg_outs(n);
+    sequence<seg<indexT>> seg_outs(n, uninitialized);
     sequence<ipair<indexT>> C = split_segment_top(seg_outs, ranks, Cl);
     Cl.clear();
     sa_timer.next("split top");
@@ -10,18 +10,29 @@
 #include "merge.h"
 #include "merge_sort.h"
 #include "bag.h"
+#include "concurrent_vector.h"
 #include "hash_table.h"
 #include "sparse_mat_vec_mult.h"
 #include "stlalgs.h"
 #include "monoid.h"
 #include "range_min.h"
+#include "strings/string_basics.h"
+#include "strings/csv.h"
+#include "strings/inverted_index.h"
+#include "compressed_sequence.h"
+#include "soa_sequence.h"
+#include "group_by.h"
+#include "execution.h"
+#include "views.h"
 
 #include <iostream>
+#include <vector>
+#include <numeric>
 #include <ctype.h>
 #include <math.h>
 #include <assert.h>
 
-static timer bt;
+static timer bt("PBBS time", true, false);
 using uchar = unsigned char;
 
 #define time(_var,_body)    \
@@ -36,6 +47,18 @@ double t_tabulate(size_t n, bool check) {
   return t;
 }
 
+template<typename T>
+double t_fill(size_t n, bool check) {
+  pbbs::sequence<T> Out;
+  time(t, Out = pbbs::sequence<T>(n, (T) 7););
+  if (check)
+    parallel_for(0, n, [&] (size_t i) {
+	if (Out[i] != (T) 7) {
+	  cout << "error in fill at " << i << endl;
+	  abort();}});
+  return t;
+}
+
 template<typename T>
 double t_map(size_t n, bool check) {
   pbbs::sequence<T> In(n, (T) 1);
@@ -87,6 +110,52 @@ double t_scan_add_seq(size_t n, bool check) {
   return t;
 }
 
+template<typename T>
+double t_segmented_scan_add(size_t n, bool check) {
+  pbbs::random r(0);
+  pbbs::sequence<T> In(n, [&] (size_t i) {return (T) (i % 7);});
+  pbbs::sequence<bool> Fl(n, [&] (size_t i) {return r.ith_rand(i) % 100 == 0;});
+  pbbs::sequence<T> Out;
+  time(t, Out = pbbs::segmented_scan(In, Fl, pbbs::addm<T>()).first;);
+  if (check) {
+    T x = 0;
+    for (size_t i=0; i < n; i++) {
+      if (Fl[i]) x = 0;
+      if (Out[i] != x) {
+	cout << "error in segmented_scan at " << i << endl;
+	abort();}
+      x += In[i];
+    }
+  }
+  return t;
+}
+
+// segments of about 100 elements
+template<typename T>
+double t_segmented_reduce_add(size_t n, bool check) {
+  pbbs::random r(0);
+  pbbs::sequence<T> In(n, [&] (size_t i) {return (T) (i % 7);});
+  pbbs::sequence<bool> Fl(n, [&] (size_t i) {
+      return i == 0 || r.ith_rand(i) % 100 == 0;});
+  auto Offsets = pbbs::pack_index<size_t>(Fl);
+  pbbs::sequence<T> Out;
+  time(t, Out = pbbs::segmented_reduce(In, Offsets, pbbs::addm<T>()););
+  if (check) {
+    size_t k = 0;
+    T x = 0;
+    for (size_t i=0; i <= n; i++) {
+      if (i == n || (i > 0 && Fl[i])) {
+	if (Out[k] != x) {
+	  cout << "error in segmented_reduce at segment " << k << endl;
+	  abort();}
+	k++; x = 0;
+      }
+      if (i < n) x += In[i];
+    }
+  }
+  return t;
+}
+
 template<typename T>
 double t_pack(size_t n, bool check) {
   pbbs::sequence<bool> flags(n, [] (size_t i) -> bool {return i%2;});
@@ -158,6 +227,66 @@ double t_gather(size_t n, bool check) {
   return t;
 }
 
+// STREAM-like kernels (copy, scale, add, triad) used to calibrate the
+// peak memory bandwidth of the machine.   All use the library
+// parallel_for so they measure what the scheduler can achieve.
+template<typename T>
+double t_stream_copy(size_t n, bool check) {
+  pbbs::sequence<T> a(n, (T) 1);
+  pbbs::sequence<T> c(n, (T) 0);
+  time(t, parallel_for(0, n, [&] (size_t i) {c[i] = a[i];}););
+  return t;
+}
+
+template<typename T>
+double t_stream_scale(size_t n, bool check) {
+  T s = 3;
+  pbbs::sequence<T> b(n, (T) 0);
+  pbbs::sequence<T> c(n, (T) 1);
+  time(t, parallel_for(0, n, [&] (size_t i) {b[i] = s * c[i];}););
+  return t;
+}
+
+template<typename T>
+double t_stream_add(size_t n, bool check) {
+  pbbs::sequence<T> a(n, (T) 1);
+  pbbs::sequence<T> b(n, (T) 2);
+  pbbs::sequence<T> c(n, (T) 0);
+  time(t, parallel_for(0, n, [&] (size_t i) {c[i] = a[i] + b[i];}););
+  return t;
+}
+
+template<typename T>
+double t_stream_triad(size_t n, bool check) {
+  T s = 3;
+  pbbs::sequence<T> a(n, (T) 0);
+  pbbs::sequence<T> b(n, (T) 1);
+  pbbs::sequence<T> c(n, (T) 2);
+  time(t, parallel_for(0, n, [&] (size_t i) {a[i] = b[i] + s * c[i];}););
+  return t;
+}
+
+// Random access latency by pointer chasing around a random cycle.
+// One chain is followed per worker, each for n/num_workers steps, so
+// the returned time is the latency of n/num_workers dependent loads.
+double t_latency(size_t n, bool check) {
+  if (n < 2) return 0.0;
+  auto perm = pbbs::random_permutation<size_t>(n);
+  pbbs::sequence<size_t> next(n);
+  parallel_for(0, n, [&] (size_t i) {
+      next[perm[i]] = perm[(i + 1 == n) ? 0 : i + 1];});
+  size_t p = num_workers();
+  size_t steps = n / p;
+  pbbs::sequence<size_t> ends(p);
+  time(t, parallel_for(0, p, [&] (size_t i) {
+	size_t j = perm[i * steps];
+	for (size_t k=0; k < steps; k++) j = next[j];
+	ends[i] = j;}, 1););
+  if (check && ends[0] != perm[steps % n])
+    cout << "error in latency chain" << endl;
+  return t;
+}
+
 template<typename T>
 double t_scatter(size_t n, bool check) {
   pbbs::random r(0);
@@ -375,7 +504,41 @@ double t_collect_reduce_8(size_t n, bool check) {
       return par(r.ith_rand(i) % num_buckets, 1);});
   auto get_key = [&] (par a) {return a.first;};
   auto get_val = [&] (par a) {return a.first;};
-  time(t, pbbs::collect_reduce(S, get_key, get_val, pbbs::addm<T>(), num_buckets););
+  pbbs::sequence<T> R;
+  time(t, R = pbbs::collect_reduce(S, get_key, get_val, pbbs::addm<T>(), num_buckets););
+  if (check) {
+    std::vector<T> expected(num_buckets, 0);
+    for (size_t i=0; i < n; i++) expected[S[i].first] += S[i].first;
+    for (size_t k=0; k < num_buckets; k++)
+      if (R[k] != expected[k]) {
+	cout << "error in collect_reduce at bucket " << k << endl;
+	abort();}
+  }
+  return t;
+}
+
+// Floating point values: the result must not depend on the schedule,
+// so the check repeats the reduce and compares bit for bit, as well as
+// comparing against a serial sum.
+template<typename T>
+double t_collect_reduce_8_float(size_t n, bool check) {
+  pbbs::random r(0);
+  size_t num_buckets = (1<<8);
+  auto key = [&] (size_t i) -> size_t {return r.ith_rand(i) % num_buckets;};
+  auto val = [&] (size_t i) -> T {return (T) (r.ith_rand(i + n) % 1000000) / 7;};
+  auto S = pbbs::delayed_seq<size_t>(n, [] (size_t i) {return i;});
+  pbbs::sequence<T> R;
+  time(t, R = pbbs::collect_reduce(S, key, val, pbbs::addm<T>(), num_buckets););
+  if (check) {
+    auto R2 = pbbs::collect_reduce(S, key, val, pbbs::addm<T>(), num_buckets);
+    std::vector<double> expected(num_buckets, 0);
+    for (size_t i=0; i < n; i++) expected[key(i)] += val(i);
+    for (size_t k=0; k < num_buckets; k++)
+      if (memcmp(&R[k], &R2[k], sizeof(T)) != 0 ||
+	  std::abs(R[k] - expected[k]) > 1e-6 * std::abs(expected[k]) + 1e-6) {
+	cout << "error in collect_reduce float at bucket " << k << endl;
+	abort();}
+  }
   return t;
 }
 
@@ -421,6 +584,27 @@ double t_integer_sort_pair(size_t n, bool check) {
   return t;
 }
 
+// sorts columns (key, ulong, ulong) by key, only moving the other
+// columns in the final gather
+template<typename T>
+double t_integer_sort_soa(size_t n, bool check) {
+  using S = pbbs::soa_sequence<T,ulong,ulong>;
+  pbbs::random r(0);
+  size_t bits = sizeof(T)*8;
+  S A(n, [&] (size_t i) {
+      return std::make_tuple((T) r.ith_rand(i), (ulong) i, (ulong) 2*i);});
+  S R;
+  time(t, R = pbbs::integer_sort_by_column<0>(A, bits););
+  if (check)
+    parallel_for(0, n, [&] (size_t i) {
+	if ((i > 0 && R.template get<0>(i-1) > R.template get<0>(i)) ||
+	    R[i] != A[R.template get<1>(i)] ||
+	    R.template get<2>(i) != 2 * R.template get<1>(i)) {
+	  cout << "error in integer sort soa at " << i << endl;
+	  abort();}});
+  return t;
+}
+
 template<typename T>
 double t_integer_sort(size_t n, bool check) {
   pbbs::random r(0);
@@ -484,6 +668,192 @@ double t_bag(size_t n, bool check) {
   return t;
 }
 
+// each i with an odd hash appends itself
+template<typename T>
+double t_vector_append(size_t n, bool check) {
+  auto keep = [] (size_t i) {return pbbs::hash64(i) & 1;};
+  pbbs::sequence<T> Out;
+  time(t,
+       pbbs::vector<T> V;
+       parallel_for(0, n, [&] (size_t i) {
+	   if (keep(i)) V.emplace_back((T) i);});
+       Out = V.to_sequence(););
+  if (check) {
+    std::sort(Out.begin(), Out.end());
+    auto R = pbbs::filter(pbbs::iota<T>(n), [&] (T i) {return keep(i);});
+    if (R.size() != Out.size() ||
+	!std::equal(R.begin(), R.end(), Out.begin())) {
+      cout << "error in vector append" << endl;
+      abort();}
+  }
+  return t;
+}
+
+// The in-place algorithms in stlalgs.h against the copy based ones.
+template<typename T, bool Inplace>
+double t_reverse(size_t n, bool check) {
+  pbbs::sequence<T> In(n, [&] (size_t i) {return (T) i;});
+  pbbs::sequence<T> Out;
+  double t;
+  if (Inplace) {
+    time(tt, pbbs::reverse_inplace(In.slice()););
+    t = tt;
+    Out = std::move(In);
+  } else {
+    time(tt, Out = pbbs::reverse(In););
+    t = tt;
+  }
+  if (check)
+    parallel_for(0, n, [&] (size_t i) {
+	if (Out[i] != (T) (n - i - 1)) {
+	  cout << "error in reverse at " << i << endl;
+	  abort();}});
+  return t;
+}
+
+template<typename T, bool Inplace>
+double t_rotate(size_t n, bool check) {
+  pbbs::sequence<T> In(n, [&] (size_t i) {return (T) i;});
+  size_t r = n / 3;
+  auto expected = [&] (size_t i) {return (T) ((i < r) ? n - r + i : i - r);};
+  if (Inplace) {
+    time(t, pbbs::rotate_inplace(In.slice(), r););
+    if (check)
+      parallel_for(0, n, [&] (size_t i) {
+	  if (In[i] != expected(i)) {
+	    cout << "error in rotate_inplace at " << i << endl;
+	    abort();}});
+    return t;
+  }
+  pbbs::sequence<T> Out;
+  time(t, Out = pbbs::rotate(In, r););
+  if (check)
+    parallel_for(0, n, [&] (size_t i) {
+	if (Out[i] != expected(i)) {
+	  cout << "error in rotate at " << i << endl;
+	  abort();}});
+  return t;
+}
+
+// about a third of the elements equal their predecessor
+template<typename T, bool Inplace>
+double t_unique(size_t n, bool check) {
+  pbbs::sequence<T> In(n, [&] (size_t i) {return (T) (pbbs::hash64(i) % 3);});
+  auto eq = [] (T a, T b) {return a == b;};
+  pbbs::sequence<T> Copy = check ? In : pbbs::sequence<T>();
+  pbbs::sequence<T> Out;
+  double t;
+  if (Inplace) {
+    size_t m;
+    time(tt, m = pbbs::unique_inplace(In.slice(), eq););
+    t = tt;
+    Out = pbbs::sequence<T>(In.slice(0, m));
+  } else {
+    time(tt, Out = pbbs::unique(In, eq););
+    t = tt;
+  }
+  if (check) {
+    size_t m = std::unique(Copy.begin(), Copy.end()) - Copy.begin();
+    if (m != Out.size() || !std::equal(Out.begin(), Out.end(), Copy.begin())) {
+      cout << "error in unique" << endl;
+      abort();}
+  }
+  return t;
+}
+
+// removes about half the elements, or if Sparse about one in 100000
+// (so most blocks of the in-place version move by a small shift)
+template<typename T, bool Inplace, bool Sparse=false>
+double t_remove_if(size_t n, bool check) {
+  pbbs::sequence<T> In(n, [&] (size_t i) {return (T) pbbs::hash64(i);});
+  auto f = [] (T a) {return Sparse ? (a % 100000) == 0 : (a & 1) == 1;};
+  pbbs::sequence<T> Copy = check ? In : pbbs::sequence<T>();
+  pbbs::sequence<T> Out;
+  double t;
+  if (Inplace) {
+    size_t m;
+    time(tt, m = pbbs::remove_if_inplace(In.slice(), f););
+    t = tt;
+    Out = pbbs::sequence<T>(In.slice(0, m));
+  } else {
+    time(tt, Out = pbbs::remove_if(In, f););
+    t = tt;
+  }
+  if (check) {
+    size_t m = std::remove_if(Copy.begin(), Copy.end(), f) - Copy.begin();
+    if (m != Out.size() || !std::equal(Out.begin(), Out.end(), Copy.begin())) {
+      cout << "error in remove_if" << endl;
+      abort();}
+  }
+  return t;
+}
+
+// The standard algorithm interface (execution.h) on a std::vector.
+template<typename T>
+double t_execution_sort(size_t n, bool check) {
+  pbbs::random r(0);
+  std::vector<T> A(n);
+  parallel_for(0, n, [&] (size_t i) {A[i] = r.ith_rand(i) % n;});
+  time(t, pbbs::execution::sort(pbbs::execution::par, A.begin(), A.end()););
+  if (check && !std::is_sorted(A.begin(), A.end())) {
+    cout << "error in execution::sort" << endl;
+    abort();}
+  return t;
+}
+
+template<typename T>
+double t_execution_inclusive_scan(size_t n, bool check) {
+  std::vector<T> A(n), Out(n);
+  parallel_for(0, n, [&] (size_t i) {A[i] = i % 7;});
+  time(t, pbbs::execution::inclusive_scan(pbbs::execution::par,
+					   A.begin(), A.end(), Out.begin()););
+  if (check) {
+    std::vector<T> R(n);
+    std::partial_sum(A.begin(), A.end(), R.begin());
+    if (R != Out) {
+      cout << "error in execution::inclusive_scan" << endl;
+      abort();}
+  }
+  return t;
+}
+
+// map, filter, map as a fused views pipeline, or with an intermediate
+// sequence after each step
+template<typename T, bool Fused>
+double t_map_filter(size_t n, bool check) {
+  pbbs::sequence<T> In(n, [&] (size_t i) {return (T) pbbs::hash64(i);});
+  auto f = [] (T a) {return a >> 3;};
+  auto p = [] (T a) {return (a & 1) == 0;};
+  auto g = [] (T a) {return a + 1;};
+  pbbs::sequence<T> Out;
+  double t;
+  if (Fused) {
+    time(tt,
+	 Out = In | pbbs::views::map(f) | pbbs::views::filter(p)
+	          | pbbs::views::map(g) | pbbs::views::to_sequence;);
+    t = tt;
+  } else {
+    time(tt,
+	 auto A = pbbs::map(In, f);
+	 auto B = pbbs::filter(A, p);
+	 Out = pbbs::map(B, g););
+    t = tt;
+  }
+  if (check) {
+    size_t k = 0;
+    for (size_t i = 0; i < n; i++) {
+      T a = f(In[i]);
+      if (p(a) && (k >= Out.size() || Out[k++] != g(a))) {
+	cout << "error in map filter at " << i << endl;
+	abort();}
+    }
+    if (k != Out.size()) {
+      cout << "error in map filter: wrong size" << endl;
+      abort();}
+  }
+  return t;
+}
+
 template<typename s_size_t, typename T>
 double t_mat_vec_mult(size_t n, bool check) {
   pbbs::random r(0);
@@ -530,6 +900,31 @@ double t_find_mid(size_t n, bool check) {
   return t;
 }
 
+// a hit at n/37, so early in one of the doubling blocks
+template<typename T>
+double t_find_early(size_t n, bool check) {
+  pbbs::sequence<T> In(n, [&] (size_t i) {return 0;});
+  In[n/37] = 1;
+  size_t idx;
+  time(t, idx = pbbs::find(In, 1););
+  if (check)
+    if (idx != n/37)
+      cout << "error in find early" << endl;
+  return t;
+}
+
+template<typename T>
+double t_any_of_mid(size_t n, bool check) {
+  pbbs::sequence<T> In(n, [&] (size_t i) {return 0;});
+  In[n/2] = 1;
+  bool r;
+  time(t, r = pbbs::any_of(In, [] (T a) {return a == 1;}););
+  if (check)
+    if (!r || pbbs::any_of(In.slice(0, n/2), [] (T a) {return a == 1;}))
+      cout << "error in any_of" << endl;
+  return t;
+}
+
 template<typename T>
 double t_lexicograhic_compare(size_t n, bool check) {
   pbbs::sequence<T> In1(n, [&] (size_t i) {return 0;});
@@ -543,3 +938,245 @@ double t_lexicograhic_compare(size_t n, bool check) {
   return t;
 }
 
+
+// parses n whitespace separated 8 digit numbers (9 bytes each)
+template<typename T>
+double t_parse_numbers(size_t n, bool check) {
+  pbbs::random r(0);
+  auto val = [&] (size_t i) -> T {return 10000000 + r.ith_rand(i) % 90000000;};
+  pbbs::sequence<char> Str(9 * n, [&] (size_t i) -> char {
+      size_t k = i % 9;
+      if (k == 8) return (i % 90 == 89) ? '\n' : ' ';
+      T v = val(i / 9);
+      for (size_t j = k; j < 7; j++) v /= 10;
+      return '0' + v % 10;});
+  pbbs::sequence<T> Out;
+  time(t, Out = pbbs::parse_numbers<T>(Str););
+  if (check)
+    parallel_for(0, n, [&] (size_t i) {
+	if (Out[i] != val(i)) {
+	  cout << "error in parse_numbers at " << i << endl;
+	  abort();}});
+  return t;
+}
+
+// compresses and decompresses sorted offsets with the given codec
+template<typename T, typename Codec>
+double t_compress(size_t n, bool check) {
+  pbbs::random r(0);
+  pbbs::sequence<T> In(n, [&] (size_t i) -> T {
+      return 10 * i + r.ith_rand(i) % 10;});
+  pbbs::sequence<T> Out;
+  time(t, Out = pbbs::compress<Codec>(In).decode(););
+  if (check)
+    parallel_for(0, n, [&] (size_t i) {
+	if (Out[i] != In[i]) {
+	  cout << "error in compress at " << i << endl;
+	  abort();}});
+  return t;
+}
+
+// Small types, whose deltas wrap.  Element i is 2i plus 0..3 (mod
+// 2^bits(T)), so the deltas are in [-1,5] and fit in 3 bits.  The check
+// also covers operator[], decode(s, e), save and load, and that the
+// encoding takes at most Bits bits per element plus the per-block
+// header.
+template<typename T, class Codec, int Bits>
+double t_compress_small(size_t n, bool check) {
+  pbbs::sequence<T> In(n, [&] (size_t i) -> T {
+      return (T) (2 * i + pbbs::hash64(i) % 4);});
+  using CS = pbbs::compressed_sequence<T,Codec>;
+  CS C;
+  pbbs::sequence<T> Out;
+  time(t, C = CS(In); Out = C.decode(););
+  if (check) {
+    auto fail = [] (const char* what) {
+      cout << "error in compress small: " << what << endl;
+      abort();};
+    parallel_for(0, n, [&] (size_t i) {
+	if (Out[i] != In[i]) fail("decode");
+	if (i % 97 == 0 && C[i] != In[i]) fail("operator[]");});
+    size_t nb = C.num_blocks();
+    size_t bound = ((nb + 1) * sizeof(size_t) + CS::padding
+		    + nb * (2 * sizeof(T) + 2) + (n * Bits + 7) / 8);
+    if (C.size_in_bytes() > bound) fail("encoding too large");
+    for (size_t k = 0; k < 20; k++) {
+      size_t s = pbbs::hash64(k) % (n + 1);
+      size_t e = s + pbbs::hash64(k + 100) % (n - s + 1);
+      auto R = C.decode(s, e);
+      for (size_t i = s; i < e; i++)
+	if (R[i - s] != In[i]) fail("decode(s, e)");
+    }
+    std::string filename = "compress_small.tmp";
+    C.save(filename);
+    auto L = CS::load(filename).decode();
+    std::remove(filename.c_str());
+    if (L.size() != n || !std::equal(L.begin(), L.end(), In.begin()))
+      fail("save and load");
+  }
+  return t;
+}
+
+// An index over n/8 ids with 32 terms, where term k holds the ids i
+// with hash(i, k) % (k+2) == 0, plus a term "none" with no ids.  Times
+// the queries k and k+1, and all but k (the ids of term 0 without
+// those of term k).  The check compares each with a serial filter.
+double t_inverted_index_query(size_t n, bool check) {
+  size_t m = n / 8 + 1, nt = 32;
+  auto has = [] (size_t k, size_t i) {
+    return pbbs::hash64(i * 64 + k) % (k + 2) == 0;};
+  auto name = [] (size_t k) -> std::string {
+    return (k == 32) ? "none" : "t" + std::to_string(k);};
+  using G = std::pair<pbbs::sequence<char>, pbbs::sequence<size_t>>;
+  pbbs::sequence<G> groups(nt + 1, [&] (size_t k) {
+      std::string w = name(k);
+      auto ids = (k == nt) ? pbbs::sequence<size_t>()
+	: pbbs::filter(pbbs::iota<size_t>(m), [&] (size_t i) {return has(k, i);});
+      return G(pbbs::sequence<char>(w.size(), [&] (size_t j) {return w[j];}),
+	       std::move(ids));});
+  auto idx = pbbs::build_inverted_index(groups);
+  auto all = idx.postings(idx.find_term("t0"));
+  pbbs::sequence<pbbs::sequence<size_t>> And, Not;
+  time(t,
+       And = pbbs::sequence<pbbs::sequence<size_t>>(nt, [&] (size_t k) {
+	   return idx.query_and({name(k), name(k + 1)});}, 1);
+       Not = pbbs::sequence<pbbs::sequence<size_t>>(nt + 1, [&] (size_t k) {
+	   return idx.query_and_not(all, name(k));}, 1););
+  if (check) {
+    auto same = [&] (pbbs::sequence<size_t> const &R, auto f, const char* what,
+		     size_t k) {
+      auto E = pbbs::filter(pbbs::iota<size_t>(m), f);
+      if (R.size() != E.size() || !std::equal(R.begin(), R.end(), E.begin())) {
+	cout << "error in inverted index " << what << " for term " << k << endl;
+	abort();}};
+    for (size_t k = 0; k < nt; k++)
+      same(And[k], [&] (size_t i) {
+	  return has(k, i) && k + 1 < nt && has(k + 1, i);}, "and", k);
+    for (size_t k = 0; k <= nt; k++)
+      same(Not[k], [&] (size_t i) {
+	  return has(0, i) && !(k < nt && has(k, i));}, "and not", k);
+  }
+  return t;
+}
+
+// n/8 words separated by spaces, drawn from a vocabulary of n/64 random
+// lower case words with geometric lengths (mean 8, about a sixth are
+// longer than 15)
+pbbs::sequence<char> random_words(size_t n) {
+  size_t nw = n / 8, vocab = n / 64 + 1;
+  auto id = [&] (size_t i) {return pbbs::hash64(i) % vocab;};
+  auto len = [] (size_t w) {
+    size_t l = 1;
+    while (l < 64 && pbbs::hash64(w * 64 + l) % 8 != 0) l++;
+    return l;};
+  pbbs::sequence<size_t> offsets(nw, [&] (size_t i) {
+      return len(id(i)) + 1;});
+  size_t m = pbbs::scan_inplace(offsets.slice(), pbbs::addm<size_t>());
+  pbbs::sequence<char> S(m, pbbs::uninitialized);
+  parallel_for(0, nw, [&] (size_t i) {
+      size_t w = id(i), l = len(w), o = offsets[i];
+      for (size_t j = 0; j < l; j++)
+	S[o + j] = 'a' + pbbs::hash64(pbbs::hash64(w) + j) % 26;
+      S[o + l] = ' ';});
+  return S;
+}
+
+template<typename Str>
+double t_tokens(size_t n, bool check) {
+  auto S = random_words(n);
+  pbbs::sequence<Str> Out;
+  time(t, Out = pbbs::tokens<Str>(S, pbbs::char_set(" ")););
+  if (check) {
+    auto R = pbbs::token_ranges(S, pbbs::char_set(" "));
+    if (R.size() != Out.size()) {
+      cout << "error in tokens: wrong count" << endl;
+      abort();}
+    parallel_for(0, R.size(), [&] (size_t i) {
+	if (R[i].size() != Out[i].size() ||
+	    !std::equal(R[i].begin(), R[i].end(), Out[i].begin())) {
+	  cout << "error in tokens at " << i << endl;
+	  abort();}});
+  }
+  return t;
+}
+
+template<typename Str>
+double t_group_by_words(size_t n, bool check) {
+  auto S = random_words(n);
+  auto W = pbbs::tokens<Str>(S, pbbs::char_set(" "));
+  using P = std::pair<Str,size_t>;
+  pbbs::sequence<pbbs::sequence<size_t>> V;
+  time(t,
+       auto G = pbbs::group_by(pbbs::tabulate(W.size(), [&] (size_t i) {
+	     return P(W[i], i);}));
+       V = pbbs::map(G, [&] (auto &g) {return std::move(g.second);}););
+  if (check) {
+    size_t total = pbbs::reduce(pbbs::delayed_seq<size_t>(V.size(), [&] (size_t i) {
+	  return V[i].size();}), pbbs::addm<size_t>());
+    if (total != W.size()) {
+      cout << "error in group by words: wrong total" << endl;
+      abort();}
+  }
+  return t;
+}
+
+// Row i of csv_file is "i,text,value" with value = i/4.  The text is
+// quoted with a delimiter, a doubled quote and a line break in it in
+// every third row, and empty in every third.  Every other row ends in
+// \r\n.
+std::string csv_text(size_t i) {
+  if (i % 3 == 0) return "x,\"y\"\nz" + std::to_string(i);
+  if (i % 3 == 1) return "plain" + std::to_string(i);
+  return "";
+}
+
+std::string csv_row(size_t i) {
+  static const char* quarters[] = {"", ".25", ".5", ".75"};
+  std::string text = (i % 3 == 0) ? "\"x,\"\"y\"\"\nz" + std::to_string(i) + "\""
+    : csv_text(i);
+  return (std::to_string(i) + "," + text + "," + std::to_string(i / 4)
+	  + quarters[i % 4] + ((i & 1) ? "\r\n" : "\n"));
+}
+
+// about n characters: a header line, the rows, and then blank lines
+// (which the parser ignores)
+pbbs::sequence<char> csv_file(size_t n) {
+  std::string head = "id,text,value\n";
+  size_t rows = n / 24 + 1;
+  pbbs::sequence<size_t> offsets(rows, [&] (size_t i) {
+      return csv_row(i).size();});
+  size_t m = pbbs::scan_inplace(offsets.slice(), pbbs::addm<size_t>());
+  std::string tail = "\n\r\n\n";
+  size_t h = head.size();
+  pbbs::sequence<char> S(h + m + tail.size(), pbbs::uninitialized);
+  std::copy(head.begin(), head.end(), S.begin());
+  parallel_for(0, rows, [&] (size_t i) {
+      std::string r = csv_row(i);
+      std::copy(r.begin(), r.end(), S.begin() + h + offsets[i]);});
+  std::copy(tail.begin(), tail.end(), S.begin() + h + m);
+  return S;
+}
+
+double t_parse_csv(size_t n, bool check) {
+  auto S = csv_file(n);
+  size_t rows = n / 24 + 1;
+  pbbs::csv_table T;
+  time(t, T = pbbs::parse_csv(S.slice()););
+  if (check) {
+    if (T.num_rows() != rows || T.num_cols() != 3 ||
+	T.names() != std::vector<std::string>({"id", "text", "value"})) {
+      cout << "error in parse_csv: wrong shape or names" << endl;
+      abort();}
+    auto ids = T.column<long>(0);
+    auto values = T.column<double>(2);
+    parallel_for(0, rows, [&] (size_t i) {
+	std::string text = csv_text(i);
+	auto f = T.field_string(i, 1);
+	if (ids[i] != (long) i || values[i] != i / 4.0 ||
+	    f.size() != text.size() ||
+	    !std::equal(f.begin(), f.end(), text.begin())) {
+	  cout << "error in parse_csv at row " << i << endl;
+	  abort();}});
+  }
+  return t;
+}
@@ -4,6 +4,7 @@
 #include "get_time.h"
 #include "time_operations.h"
 #include "parse_command_line.h"
+#include "memory_usage.h"
 #include <iostream>
 #include <ctype.h>
 #include <math.h>
@@ -49,6 +50,10 @@ double maxf(double a, double b) {return (a > b) ? a : b;};
 
 bool global_check = false;
 
+// peak memory bandwidth in GB/s as measured by calibrate().
+// zero if not calibrated
+double peak_bw = 0.0;
+
 template<typename F>
 bool run_multiple(size_t n, size_t rounds, float bytes_per_elt,
 		  std::string name, F test, bool half_length=1, std::string x="bw") {
@@ -73,8 +78,12 @@ bool run_multiple(size_t n, size_t rounds, float bytes_per_elt,
        << ", med=" << med
        << " (" << mint << "," << maxt << "), "
        << "hlen=" << round(l) << ", "
-       << x << " = " << bandwidth
-       << endl;
+       << x << " = " << bandwidth;
+  if (peak_bw > 0.0 && x == "bw")
+    cout << ", peak frac = " << bandwidth/peak_bw;
+  cout << ", peak alloc = " << pbbs::default_allocator.peak_bytes_in_use()/1e6
+       << " MB, peak rss = " << pbbs::peak_rss()/1e6 << " MB";
+  cout << endl;
   return 1;
 }
 
@@ -86,9 +95,48 @@ float ebytes(int reads, int write_backs) {
   return reads * bytes_per_read + write_backs * bytes_per_write_back;
 }
 
+// bandwidth in GB/s based on the fastest of the rounds
+template<typename F>
+double measure_bw(size_t n, size_t rounds, float bytes_per_elt, F test) {
+  pbbs::allocator_clear();
+  double mint = reduce(repeat(n, rounds, global_check, test), minf);
+  return n * bytes_per_elt / mint / 1e9;
+}
+
+// Measures the peak memory bandwidth of the machine using STREAM-like
+// kernels, and sets peak_bw to the best of them.  Benchmarks that report
+// bandwidth ("bw") then also report it as a fraction of this peak.
+// Also reports random access latency and gather bandwidth for reference.
+void calibrate(size_t n, size_t rounds) {
+  struct kernel {std::string name; float bytes; double (*test)(size_t, bool);};
+  std::vector<kernel> kernels = {
+    {"copy", ebytes(8,8), t_stream_copy<long>},
+    {"scale", ebytes(8,8), t_stream_scale<long>},
+    {"add", ebytes(16,8), t_stream_add<long>},
+    {"triad", ebytes(16,8), t_stream_triad<long>}};
+
+  cout << "calibration:" << endl;
+  for (auto k : kernels) {
+    double bw = measure_bw(n, rounds, k.bytes, k.test);
+    cout << "  stream " << k.name << std::setprecision(3)
+	 << ": bw = " << bw << endl;
+    peak_bw = std::max(peak_bw, bw);
+  }
+
+  double gather_bw = measure_bw(n, rounds, ebytes(80,8), t_gather<long>);
+  cout << "  gather: bw = " << gather_bw << endl;
+
+  pbbs::allocator_clear();
+  size_t steps = n / num_workers();
+  double lt = reduce(repeat(n, rounds, global_check, t_latency), minf);
+  cout << "  random access latency: " << lt * 1e9 / steps << " ns" << endl;
+  cout << "  peak bw = " << peak_bw << endl;
+}
+
 double pick_test(size_t id, size_t n, size_t rounds,
 		 bool half_length) {
   pbbs::allocator_clear();
+  pbbs::reset_peak_memory();
   
   switch (id) {
   case 0:
@@ -169,6 +217,84 @@ double pick_test(size_t id, size_t n, size_t rounds,
     return run_multiple(n,rounds,ebytes(24,8),"scan add long seq", t_scan_add_seq<long>, half_length);
   case 52:
     return run_multiple(n,rounds,1, "range_min long", t_range_min<long>, half_length, "Gelts/sec");
+  case 53:
+    return run_multiple(n,rounds,ebytes(8,8),"stream copy long", t_stream_copy<long>, half_length);
+  case 54:
+    return run_multiple(n,rounds,ebytes(8,8),"stream scale long", t_stream_scale<long>, half_length);
+  case 55:
+    return run_multiple(n,rounds,ebytes(16,8),"stream add long", t_stream_add<long>, half_length);
+  case 56:
+    return run_multiple(n,rounds,ebytes(16,8),"stream triad long", t_stream_triad<long>, half_length);
+  case 57:
+    return run_multiple(n,rounds,ebytes(9,8),"parse_numbers long", t_parse_numbers<long>, half_length);
+  case 58:
+    return run_multiple(n,rounds,ebytes(8,8),"compress delta ulong", t_compress<ulong,pbbs::delta_codec>, half_length);
+  case 59:
+    return run_multiple(n,rounds,ebytes(8,8),"compress for ulong", t_compress<ulong,pbbs::for_codec>, half_length);
+  case 60:
+    return run_multiple(n,rounds,ebytes(8,8),"compress group varint ulong", t_compress<ulong,pbbs::group_varint_codec>, half_length);
+  case 61:
+    return run_multiple(n,rounds,ebytes(17,8),"segmented scan add long", t_segmented_scan_add<long>, half_length);
+  case 62:
+    return run_multiple(n,rounds,1,"integer sort soa<uint,ulong,ulong>", t_integer_sort_soa<uint>, half_length, "Gelts/sec");
+  case 63:
+    return run_multiple(n,rounds,ebytes(0,8),"fill long", t_fill<long>, half_length);
+  case 64:
+    return run_multiple(n,rounds,1,"tokens sequence<char>", t_tokens<pbbs::sequence<char>>, half_length, "Gbytes/sec");
+  case 65:
+    return run_multiple(n,rounds,1,"tokens short_string", t_tokens<pbbs::short_string>, half_length, "Gbytes/sec");
+  case 66:
+    return run_multiple(n,rounds,1,"group by words sequence<char>", t_group_by_words<pbbs::sequence<char>>, half_length, "Gbytes/sec");
+  case 67:
+    return run_multiple(n,rounds,1,"group by words short_string", t_group_by_words<pbbs::short_string>, half_length, "Gbytes/sec");
+  case 68:
+    return run_multiple(n,rounds,1,"vector append long", t_vector_append<long>, half_length, "Gelts/sec");
+  case 69:
+    return run_multiple(n,rounds,ebytes(8,8),"reverse long", t_reverse<long,false>, half_length);
+  case 70:
+    return run_multiple(n,rounds,ebytes(8,8),"reverse_inplace long", t_reverse<long,true>, half_length);
+  case 71:
+    return run_multiple(n,rounds,ebytes(8,8),"rotate long", t_rotate<long,false>, half_length);
+  case 72:
+    return run_multiple(n,rounds,ebytes(8,8),"rotate_inplace long", t_rotate<long,true>, half_length);
+  case 73:
+    return run_multiple(n,rounds,ebytes(8,8),"unique long", t_unique<long,false>, half_length);
+  case 74:
+    return run_multiple(n,rounds,ebytes(8,8),"unique_inplace long", t_unique<long,true>, half_length);
+  case 75:
+    return run_multiple(n,rounds,ebytes(8,8),"remove_if long", t_remove_if<long,false>, half_length);
+  case 76:
+    return run_multiple(n,rounds,ebytes(8,8),"remove_if_inplace long", t_remove_if<long,true>, half_length);
+  case 77:
+    return run_multiple(n,rounds,8.0/37,"find early long", t_find_early<long>, half_length);
+  case 78:
+    return run_multiple(n,rounds,ebytes(4,0),"any_of mid long", t_any_of_mid<long>, half_length);
+  case 79:
+    return run_multiple(n,rounds,1,"execution::sort long", t_execution_sort<long>, half_length, "Gelts/sec");
+  case 80:
+    return run_multiple(n,rounds,ebytes(24,8),"execution::inclusive_scan long", t_execution_inclusive_scan<long>, half_length);
+  case 81:
+    return run_multiple(n,rounds,ebytes(8,4),"views map filter long", t_map_filter<long,true>, half_length);
+  case 82:
+    return run_multiple(n,rounds,ebytes(8,4),"map filter long", t_map_filter<long,false>, half_length);
+  case 83:
+    return run_multiple(n,rounds,ebytes(8,0),"reduce add double", t_reduce_add<double>, half_length);
+  case 84:
+    return run_multiple(n,rounds,ebytes(8,8),"remove_if_inplace sparse long", t_remove_if<long,true,true>, half_length);
+  case 85:
+    return run_multiple(n,rounds,ebytes(8,0),"segmented reduce add long", t_segmented_reduce_add<long>, half_length);
+  case 86:
+    return run_multiple(n,rounds,1,"parse csv", t_parse_csv, half_length, "Gbytes/sec");
+  case 87:
+    return run_multiple(n,rounds,ebytes(1,1),"compress delta uchar", t_compress_small<uchar,pbbs::delta_codec,3>, half_length);
+  case 88:
+    return run_multiple(n,rounds,ebytes(2,2),"compress delta ushort", t_compress_small<unsigned short,pbbs::delta_codec,3>, half_length);
+  case 89:
+    return run_multiple(n,rounds,ebytes(2,2),"compress bitpack ushort", t_compress_small<unsigned short,pbbs::bitpack_codec,16>, half_length);
+  case 90:
+    return run_multiple(n,rounds,1,"inverted index query", t_inverted_index_query, half_length, "Gelts/sec");
+  case 91:
+    return run_multiple(n,rounds,1,"collect reduce 256 buckets double", t_collect_reduce_8_float<double>, half_length,"Gelts/sec");
   default:
     assert(false);
     return 0.0 ;
@@ -177,12 +303,13 @@ double pick_test(size_t id, size_t n, size_t rounds,
 
 int main (int argc, char *argv[]) {
   commandLine P(argc, argv,
-		"[-n <size>] [-r <rounds>] [-halflen] [-t <testid>]");
+		"[-n <size>] [-r <rounds>] [-halflen] [-calibrate] [-t <testid>]");
   size_t n = P.getOptionLongValue("-n", 100000000);
   int rounds = P.getOptionIntValue("-r", 5);
   int test_num = P.getOptionIntValue("-t", -1);
   bool half_length = P.getOption("-halflen");
   global_check = P.getOption("-check");
+  bool do_calibrate = P.getOption("-calibrate");
   int num_tests = 33;
 
   cout << "n = " << n << endl;
@@ -190,6 +317,7 @@ int main (int argc, char *argv[]) {
   cout << "num threads = " << num_workers() << endl;
   if (half_length) cout << "half length on" << endl;
   else cout << "half length off" << endl;
+  if (do_calibrate) calibrate(n, rounds);
 
   if (test_num == -1)
     for (int i=0; i < num_tests; i++)
@@ -10,6 +10,9 @@
 #include <atomic>
 #include <cstring>
 #include "parallel.h"
+#if defined(__SSE2__) && defined(__x86_64__)
+#include <immintrin.h>
+#endif
 
 using std::cout;
 using std::endl;
@@ -90,9 +93,71 @@ namespace pbbs {
     new (static_cast<void*>(std::addressof(a))) T(std::move(b));
   }
 
+  // Fills of at least this many bytes use non-temporal (streaming)
+  // stores.  The result would not fit in cache anyway, and it saves
+  // reading every line in just to overwrite it.
+  constexpr size_t nontemporal_threshold = ((size_t) 1) << 22;
+  constexpr size_t fill_block_bytes = ((size_t) 1) << 16;
+
+  // Sets the m words starting at A to w, in parallel.
+  inline void fill_words(uint64_t* A, size_t m, uint64_t w) {
+    constexpr size_t bw = fill_block_bytes / sizeof(uint64_t);
+    bool stream = m * sizeof(uint64_t) >= nontemporal_threshold;
+    parallel_for(0, (m + bw - 1) / bw, [&] (size_t i) {
+	size_t s = i * bw, e = std::min(m, s + bw);
+#if defined(__SSE2__) && defined(__x86_64__)
+	if (stream) {
+	  for (size_t j = s; j < e; j++)
+	    _mm_stream_si64((long long*) (A + j), (long long) w);
+	  _mm_sfence();
+	  return;
+	}
+#endif
+	for (size_t j = s; j < e; j++) A[j] = w;
+      }, 1);
+  }
+
+  // Fills the uninitialized A[0,n) with copies of v, in parallel.
+  // Elements of 1, 2, 4 or 8 bytes are written a word at a time.
+  template <typename T>
+  void fill_uninitialized(T* A, size_t n, T const &v) {
+    if constexpr (std::is_trivially_copyable<T>::value &&
+		  sizeof(T) <= 8 && 8 % sizeof(T) == 0) {
+      if (n * sizeof(T) >= fill_block_bytes &&
+	  ((uintptr_t) A) % sizeof(T) == 0) {
+	uint64_t w;
+	for (size_t i = 0; i < 8 / sizeof(T); i++)
+	  std::memcpy(((char*) &w) + i * sizeof(T), &v, sizeof(T));
+	size_t head = ((8 - ((uintptr_t) A) % 8) % 8) / sizeof(T);
+	size_t m = (n - head) * sizeof(T) / 8;
+	size_t tail = head + m * 8 / sizeof(T);
+	for (size_t i = 0; i < head; i++) A[i] = v;
+	fill_words((uint64_t*) (A + head), m, w);
+	for (size_t i = tail; i < n; i++) A[i] = v;
+	return;
+      }
+    }
+    parallel_for(0, n, [&] (size_t i) {assign_uninitialized(A[i], v);}, 1000);
+  }
+
+  // Sets all bytes of A[0,n) to zero, in parallel.
+  template <typename T>
+  void zero_uninitialized(T* A, size_t n) {
+    static_assert(std::is_trivially_copyable<T>::value,
+		  "zero_uninitialized requires a trivially copyable type");
+    char* s = (char*) A;
+    size_t bytes = n * sizeof(T);
+    if (bytes < fill_block_bytes) {std::memset(s, 0, bytes); return;}
+    size_t head = (8 - ((uintptr_t) s) % 8) % 8;
+    size_t m = (bytes - head) / 8;
+    std::memset(s, 0, head);
+    fill_words((uint64_t*) (s + head), m, 0);
+    std::memset(s + head + 8 * m, 0, bytes - head - 8 * m);
+  }
+
   template<typename T>
   inline void copy_memory(T& a, const T &b) {
-    std::memcpy(&a, &b, sizeof(T));
+    std::memcpy((void*) &a, (void*) &b, sizeof(T));
   }
 
   enum _copy_type { _assign, _move, _copy};
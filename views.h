@@ -0,0 +1,243 @@
+// This code is part of the Problem Based Benchmark Suite (PBBS)
+// Copyright (c) 2011-2019 Guy Blelloch and the PBBS team
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights (to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+// LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// Pipelines over sequences without intermediate sequences, e.g.
+//
+//   auto r = A | views::map(f) | views::filter(p) | views::map(g)
+//              | views::to_sequence;
+//
+// runs as a single filter kernel (one pass to count, one to write
+// g(f(A[i])) for the kept i), and
+//
+//   pbbs::reduce(A | views::map(f) | views::filter(p), m)
+//
+// as a single reduce.  map, take and drop give delayed sequences, so
+// any Seq function (reduce, scan, find_if, ...) can consume them.
+// filter gives a filter_view, which only supports further map and
+// filter stages, reduce, and to_sequence (other adaptors materialize
+// it first).
+//
+// A stage keeps a reference to an lvalue input, which must outlive
+// the pipeline, and takes ownership of an rvalue: delayed sequences
+// are copied and a sequence is moved to shared storage.  In C++20
+// delayed sequences (and so these views) model
+// std::ranges::random_access_range through their iterators.
+
+#pragma once
+
+#include <memory>
+#include <functional>
+#include <type_traits>
+#include "sequence.h"
+
+#if defined(__cpp_lib_ranges)
+#include <ranges>
+#endif
+
+namespace pbbs {
+namespace views {
+
+  // ***** how a stage holds its input *****
+
+  template <class S> struct is_owning : std::false_type {};
+  template <class T, class A, size_t N>
+  struct is_owning<sequence<T,A,N>> : std::true_type {};
+
+  template <class S>
+  auto hold(S &&s) {
+    using D = typename std::decay<S>::type;
+    if constexpr (std::is_lvalue_reference<S>::value)
+      return std::cref(s);
+    else if constexpr (is_owning<D>::value)
+      return std::shared_ptr<const D>(std::make_shared<const D>(std::move(s)));
+    else return D(std::move(s));
+  }
+
+  template <class S> S const &unwrap(S const &s) {return s;}
+  template <class S> S const &unwrap(std::reference_wrapper<S> s) {return s.get();}
+  template <class S> S const &unwrap(std::shared_ptr<S> const &s) {return *s;}
+
+  template <class H>
+  using held_value_type =
+    typename std::decay<decltype(unwrap(std::declval<H const &>()))>::type::value_type;
+
+  // ***** adaptors *****
+
+  template <class F> struct map_t {F f;};
+  template <class P> struct filter_t {P p;};
+  struct take_t {size_t n;};
+  struct drop_t {size_t n;};
+  struct to_sequence_t {};
+
+  // element i is f(S[i])
+  template <class F>
+  map_t<F> map(F f) {return map_t<F>{f};}
+
+  // the elements with p true, in order
+  template <class P>
+  filter_t<P> filter(P p) {return filter_t<P>{p};}
+
+  // the first n (or all if fewer), or all but the first n
+  inline take_t take(size_t n) {return take_t{n};}
+  inline drop_t drop(size_t n) {return drop_t{n};}
+
+  // ends a pipeline with the result in a new sequence
+  constexpr to_sequence_t to_sequence{};
+
+  // The elements g(x) for the x in the held sequence with p(x).
+  template <class H, class P, class G>
+  struct filter_view {
+    using in_type = held_value_type<H>;
+    using value_type = typename std::decay<
+      decltype(std::declval<G const &>()(std::declval<in_type>()))>::type;
+
+    H s; P p; G g;
+
+    // Same blocks as filter_out: one pass evaluates p and counts, the
+    // other writes g of the kept elements.
+    sequence<value_type> to_sequence() const {
+      auto const &S = unwrap(s);
+      size_t n = S.size();
+      size_t l = num_blocks(n, _block_size);
+      sequence<size_t> Sums(l, uninitialized);
+      sequence<bool> Fl(n, uninitialized);
+      sliced_for(n, _block_size, [&] (size_t i, size_t st, size_t e) {
+	  size_t r = 0;
+	  for (size_t j = st; j < e; j++) r += (Fl[j] = p(S[j]));
+	  Sums[i] = r;});
+      size_t m = scan_inplace(Sums.slice(), addm<size_t>());
+      sequence<value_type> R(m, uninitialized);
+      sliced_for(n, _block_size, [&] (size_t i, size_t st, size_t e) {
+	  size_t k = Sums[i];
+	  for (size_t j = st; j < e; j++)
+	    if (Fl[j]) assign_uninitialized(R[k++], (value_type) g(S[j]));});
+      return R;
+    }
+  };
+
+  template <class S> struct is_filter_view : std::false_type {};
+  template <class H, class P, class G>
+  struct is_filter_view<filter_view<H,P,G>> : std::true_type {};
+
+  // the Seq | adaptor overloads are for anything but a filter_view
+  template <class S>
+  using if_seq = typename std::enable_if<
+    !is_filter_view<typename std::decay<S>::type>::value, int>::type;
+
+  template <class H, class P, class G>
+  filter_view<H,P,G> make_filter_view(H s, P p, G g) {
+    return filter_view<H,P,G>{std::move(s), std::move(p), std::move(g)};}
+
+  struct identity_f {
+    template <class T> T operator() (T const &a) const {return a;}};
+
+  // ***** Seq | adaptor *****
+
+  template <class S, class F, if_seq<S> = 0>
+  auto operator| (S &&s, map_t<F> m) {
+    auto h = hold(std::forward<S>(s));
+    using T = typename std::decay<
+      decltype(m.f(std::declval<held_value_type<decltype(h)>>()))>::type;
+    size_t n = unwrap(h).size();
+    return delayed_seq<T>(n, [h, f = m.f] (size_t i) -> T {
+	return f(unwrap(h)[i]);});
+  }
+
+  template <class S, class P, if_seq<S> = 0>
+  auto operator| (S &&s, filter_t<P> f) {
+    return make_filter_view(hold(std::forward<S>(s)), f.p, identity_f());}
+
+  template <class S, if_seq<S> = 0>
+  auto operator| (S &&s, take_t t) {
+    auto h = hold(std::forward<S>(s));
+    using T = held_value_type<decltype(h)>;
+    size_t n = std::min(t.n, unwrap(h).size());
+    return delayed_seq<T>(n, [h] (size_t i) -> T {return unwrap(h)[i];});
+  }
+
+  template <class S, if_seq<S> = 0>
+  auto operator| (S &&s, drop_t d) {
+    auto h = hold(std::forward<S>(s));
+    using T = held_value_type<decltype(h)>;
+    size_t m = unwrap(h).size();
+    size_t k = std::min(d.n, m);
+    return delayed_seq<T>(m - k, [h, k] (size_t i) -> T {
+	return unwrap(h)[k + i];});
+  }
+
+  template <class S, if_seq<S> = 0>
+  auto operator| (S const &s, to_sequence_t) {
+    using T = typename S::value_type;
+    return sequence<T>(s.size(), [&] (size_t i) -> T {return s[i];});
+  }
+
+  // ***** filter_view | adaptor *****
+
+  // map composes into the output function
+  template <class H, class P, class G, class F>
+  auto operator| (filter_view<H,P,G> v, map_t<F> m) {
+    auto g = v.g;
+    return make_filter_view(std::move(v.s), std::move(v.p),
+			    [g, f = m.f] (auto const &a) {return f(g(a));});
+  }
+
+  // filter conjoins into the predicate
+  template <class H, class P, class G, class Q>
+  auto operator| (filter_view<H,P,G> v, filter_t<Q> q) {
+    auto p = v.p; auto g = v.g;
+    return make_filter_view(std::move(v.s),
+			    [p, g, q = q.p] (auto const &a) {return p(a) && q(g(a));},
+			    std::move(v.g));
+  }
+
+  template <class H, class P, class G>
+  auto operator| (filter_view<H,P,G> const &v, to_sequence_t) {
+    return v.to_sequence();}
+
+  template <class H, class P, class G>
+  auto operator| (filter_view<H,P,G> const &v, take_t t) {
+    return v.to_sequence() | t;}
+
+  template <class H, class P, class G>
+  auto operator| (filter_view<H,P,G> const &v, drop_t d) {
+    return v.to_sequence() | d;}
+
+#if defined(__cpp_lib_ranges)
+  static_assert(std::ranges::random_access_range<
+		decltype(delayed_seq<size_t>(1, [] (size_t i) {return i;})
+			  | map([] (size_t i) {return i;}))>);
+  static_assert(std::ranges::random_access_range<sequence<int>>);
+#endif
+}
+
+  // Reduces the kept elements without materializing them: the others
+  // contribute the identity.
+  template <class H, class P, class G, class Monoid>
+  auto reduce(views::filter_view<H,P,G> const &v, Monoid m, flags fl = no_flag)
+    -> typename Monoid::T {
+    using T = typename Monoid::T;
+    auto const &S = views::unwrap(v.s);
+    return reduce(delayed_seq<T>(S.size(), [&] (size_t i) -> T {
+	  auto const &a = S[i];
+	  return v.p(a) ? (T) v.g(a) : m.identity;}), m, fl);
+  }
+}